@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* 이 파일의 코드는 ATA (IDE) 컨트롤러에 대한 인터페이스입니다.
    [ATA-3] 표준을 준수하려고 시도합니다. */
@@ -220,6 +221,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
 	input_sector (c, buffer);
 	d->read_cnt++;
+	thread_current ()->disk_sectors++;
 	lock_release (&c->lock);
 }
 
@@ -243,6 +245,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	output_sector (c, buffer);
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
+	thread_current ()->disk_sectors++;
 	lock_release (&c->lock);
 }
 
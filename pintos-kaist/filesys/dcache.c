@@ -0,0 +1,170 @@
+/* dcache.c: 디렉토리 엔트리 캐시
+ *
+ * (부모 디렉토리 inode 섹터, 이름)을 열쇠로 이름 검색 결과를 메모리에
+ * 담아 둠. 찾은 결과(양의 엔트리)뿐 아니라 없다는 결과(음의 엔트리)도
+ * 담아 두어, 같은 이름을 다시 찾을 때 디렉토리를 읽지 않음
+ * 디렉토리가 바뀌면 directory.c가 해당 엔트리를 갱신함. 엔트리는
+ * DCACHE_MAX개까지 두며, 넘치면 가장 오래전에 쓰인 것부터 버림 */
+
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* 캐시에 담아 두는 최대 엔트리 수 */
+#define DCACHE_MAX 256
+
+/* 캐시된 이름 검색 결과 */
+struct dentry {
+	disk_sector_t parent;               /* 부모 디렉토리 inode 섹터 */
+	char name[NAME_MAX + 1];            /* 이름 */
+	disk_sector_t sector;               /* 이름의 inode 섹터, 없으면 0 */
+	struct hash_elem elem;              /* 캐시 해시의 요소 */
+	struct list_elem lru_elem;          /* LRU 리스트의 요소 */
+};
+
+static struct hash dentries;
+static struct list lru;                 /* 앞쪽이 최근에 쓰인 엔트리 */
+static size_t dentry_cnt;
+static struct lock dcache_lock;
+
+/* 통계 */
+static long long hit_cnt;               /* 양의 엔트리로 찾음 */
+static long long neg_hit_cnt;           /* 음의 엔트리로 찾음 */
+static long long miss_cnt;              /* 캐시에 없었음 */
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, elem);
+	return hash_string (d->name) ^ hash_int (d->parent);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, elem);
+
+	if (a->parent != b->parent)
+		return a->parent < b->parent;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* 디렉토리 엔트리 캐시를 초기화 */
+void
+dcache_init (void) {
+	if (!hash_init (&dentries, dentry_hash, dentry_less, NULL))
+		PANIC ("dentry cache creation failed");
+	list_init (&lru);
+	lock_init (&dcache_lock);
+}
+
+/* PARENT 안의 NAME에 대한 엔트리를 찾아 반환, 없으면 null 포인터 */
+static struct dentry *
+dentry_find (disk_sector_t parent, const char *name) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.parent = parent;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dentries, &key.elem);
+	return e != NULL ? hash_entry (e, struct dentry, elem) : NULL;
+}
+
+/* D를 캐시에서 빼고 해제 */
+static void
+dentry_free (struct dentry *d) {
+	hash_delete (&dentries, &d->elem);
+	list_remove (&d->lru_elem);
+	dentry_cnt--;
+	free (d);
+}
+
+/* 디렉토리 PARENT 안의 NAME을 캐시에서 찾음
+ * 캐시에 있으면 *SECTORP에 NAME의 inode 섹터를, NAME이 없다고
+ * 기록되어 있으면 0을 저장하고 true를 반환
+ * 캐시에 없으면 false를 반환 */
+bool
+dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return false;
+
+	lock_acquire (&dcache_lock);
+	d = dentry_find (parent, name);
+	if (d != NULL) {
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+		*sectorp = d->sector;
+		if (d->sector != 0)
+			hit_cnt++;
+		else
+			neg_hit_cnt++;
+	} else
+		miss_cnt++;
+	lock_release (&dcache_lock);
+	return d != NULL;
+}
+
+/* 디렉토리 PARENT 안의 NAME이 SECTOR의 inode를 가리킨다고 기록
+ * SECTOR가 0이면 NAME이 없다고 기록. 이미 있는 엔트리는 덮어씀 */
+void
+dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	d = dentry_find (parent, name);
+	if (d != NULL) {
+		d->sector = sector;
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+	} else {
+		d = malloc (sizeof *d);
+		if (d != NULL) {
+			d->parent = parent;
+			strlcpy (d->name, name, sizeof d->name);
+			d->sector = sector;
+			hash_insert (&dentries, &d->elem);
+			list_push_front (&lru, &d->lru_elem);
+			if (++dentry_cnt > DCACHE_MAX)
+				dentry_free (list_entry (list_back (&lru),
+							struct dentry, lru_elem));
+		}
+	}
+	lock_release (&dcache_lock);
+}
+
+/* 디렉토리 PARENT 안의 엔트리를 모두 버림
+ * 디렉토리 inode 섹터가 새 디렉토리에 다시 쓰일 때 옛 결과를 지움 */
+void
+dcache_invalidate_dir (disk_sector_t parent) {
+	struct list_elem *e;
+
+	lock_acquire (&dcache_lock);
+	for (e = list_begin (&lru); e != list_end (&lru);) {
+		struct dentry *d = list_entry (e, struct dentry, lru_elem);
+
+		e = list_next (e);
+		if (d->parent == parent)
+			dentry_free (d);
+	}
+	lock_release (&dcache_lock);
+}
+
+/* 디렉토리 엔트리 캐시 통계를 출력 */
+void
+dcache_print_stats (void) {
+	printf ("Dentry cache: %lld hits, %lld negative hits, %lld misses\n",
+			hit_cnt, neg_hit_cnt, miss_cnt);
+}
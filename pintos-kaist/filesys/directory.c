@@ -1,7 +1,9 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -19,10 +21,365 @@ struct dir_entry {
 	bool in_use;                        /* 사용 중인지 비어있는지 여부 */
 };
 
+/* 엔트리 수가 이보다 많아지면 디렉토리에 해시 인덱스를 만듦 */
+#define DIR_INDEX_MIN_ENTRIES 32
+
+/* 디렉토리 인덱스를 식별 */
+#define DIR_INDEX_MAGIC 0x44494458
+
+/* 디렉토리 인덱스
+ * 엔트리가 많은 디렉토리는 이름의 해시로 엔트리 오프셋을 찾는 해시
+ * 테이블을 별도의 inode에 두며, 그 섹터는 디렉토리 inode에 기록됨
+ * 첫 섹터는 헤더이고 두 번째 섹터부터 버킷들이 이어짐. 버킷은 섹터
+ * 하나 크기의 슬롯 배열이며, 버킷이 차면 다음 버킷으로 넘어가는 선형
+ * 탐사를 씀. 지운 슬롯은 묘비로 남겨 탐사가 끊기지 않게 함
+ * 인덱스가 있는 디렉토리의 빈 엔트리들은 INODE_SECTOR 필드로 이어진
+ * 빈 엔트리 리스트에 들어 있어, 추가할 때 디렉토리를 훑지 않음 */
+struct index_header {
+	unsigned magic;                     /* 매직 넘버 */
+	uint32_t bucket_cnt;                /* 버킷 수, 2의 거듭제곱 */
+	uint32_t used_cnt;                  /* 비어 있지 않은 슬롯 수 (묘비 포함) */
+	uint32_t free_head;                 /* 첫 빈 엔트리의 오프셋 + 1, 없으면 0 */
+};
+
+/* 인덱스 슬롯 */
+struct index_slot {
+	uint32_t hash;                      /* 엔트리 이름의 해시 */
+	uint32_t ofs;                       /* 엔트리 오프셋 + 1, 비었으면 0 */
+};
+
+/* 버킷 하나에 든 슬롯 수 */
+#define BUCKET_SLOTS (DISK_SECTOR_SIZE / sizeof (struct index_slot))
+
+/* 지워진 엔트리를 가리켰던 슬롯 */
+#define SLOT_TOMB UINT32_MAX
+
+/* 인덱스 파일에서 버킷 B의 바이트 오프셋을 반환 */
+static inline off_t
+bucket_ofs (uint32_t b) {
+	return (off_t) (b + 1) * DISK_SECTOR_SIZE;
+}
+
+/* DIR의 인덱스 inode를 열어 반환
+ * 인덱스가 없으면 null 포인터를 반환 */
+static struct inode *
+index_open (const struct dir *dir) {
+	disk_sector_t sector = inode_get_index (dir->inode);
+	return sector != 0 ? inode_open (sector) : NULL;
+}
+
+/* INDEX의 헤더를 HDR로 읽음. 성공하면 true를 반환 */
+static bool
+index_read_header (struct inode *index, struct index_header *hdr) {
+	return inode_read_at (index, hdr, sizeof *hdr, 0) == sizeof *hdr
+		&& hdr->magic == DIR_INDEX_MAGIC;
+}
+
+/* HDR을 INDEX의 헤더로 씀. 성공하면 true를 반환 */
+static bool
+index_write_header (struct inode *index, const struct index_header *hdr) {
+	return inode_write_at (index, hdr, sizeof *hdr, 0) == sizeof *hdr;
+}
+
+/* INDEX에서 해시 H를 가진 슬롯들을 탐사 순서대로 찾음
+ * 각 슬롯마다 FOUND를 호출해 참이면 멈추고, 빈 슬롯을 만나면 멈춤
+ * FOUND가 참을 반환한 슬롯을 가진 버킷은 BUCKET에 읽혀 있으며,
+ * 그 버킷 번호를 *BP에, 슬롯 번호를 *SP에 저장하고 true를 반환 */
+static bool
+index_probe (struct inode *index, const struct index_header *hdr,
+		uint32_t h, struct index_slot *bucket,
+		bool (*found) (const struct index_slot *, void *), void *aux,
+		uint32_t *bp, size_t *sp) {
+	uint32_t mask = hdr->bucket_cnt - 1;
+	uint32_t b = h & mask;
+	uint32_t i;
+
+	for (i = 0; i < hdr->bucket_cnt; i++, b = (b + 1) & mask) {
+		size_t s;
+
+		if (inode_read_at (index, bucket, DISK_SECTOR_SIZE, bucket_ofs (b))
+				!= DISK_SECTOR_SIZE)
+			return false;
+		for (s = 0; s < BUCKET_SLOTS; s++) {
+			if (found (&bucket[s], aux)) {
+				*bp = b;
+				*sp = s;
+				return true;
+			}
+			if (bucket[s].ofs == 0)
+				return false;
+		}
+	}
+	return false;
+}
+
+/* index_find()가 index_probe()에 넘기는 인자 */
+struct find_aux {
+	const struct dir *dir;
+	uint32_t hash;
+	const char *name;
+	struct dir_entry *ep;
+};
+
+/* SLOT이 찾는 이름의 엔트리를 가리키면 true를 반환하고 그 엔트리를
+ * AUX->EP에 읽어 둠 */
+static bool
+slot_matches_name (const struct index_slot *slot, void *aux_) {
+	struct find_aux *aux = aux_;
+
+	if (slot->ofs == 0 || slot->ofs == SLOT_TOMB || slot->hash != aux->hash)
+		return false;
+	return inode_read_at (aux->dir->inode, aux->ep, sizeof *aux->ep,
+				slot->ofs - 1) == sizeof *aux->ep
+		&& aux->ep->in_use && !strcmp (aux->name, aux->ep->name);
+}
+
+/* 비었거나 묘비인 슬롯이면 true를 반환 */
+static bool
+slot_is_free (const struct index_slot *slot, void *aux UNUSED) {
+	return slot->ofs == 0 || slot->ofs == SLOT_TOMB;
+}
+
+/* 엔트리 오프셋이 *AUX인 슬롯이면 true를 반환 */
+static bool
+slot_has_ofs (const struct index_slot *slot, void *aux) {
+	return slot->ofs == *(uint32_t *) aux;
+}
+
+/* DIR의 인덱스 INDEX에서 NAME을 찾음
+ * 찾으면 *EP에 엔트리를, *OFSP에 엔트리 오프셋을 저장하고 true를 반환 */
+static bool
+index_find (const struct dir *dir, struct inode *index, const char *name,
+		struct dir_entry *ep, off_t *ofsp) {
+	struct index_header hdr;
+	struct index_slot *bucket;
+	struct find_aux aux;
+	uint32_t b;
+	size_t s;
+	bool found = false;
+
+	if (!index_read_header (index, &hdr))
+		return false;
+	bucket = malloc (DISK_SECTOR_SIZE);
+	if (bucket == NULL)
+		return false;
+
+	aux.dir = dir;
+	aux.hash = hash_string (name);
+	aux.name = name;
+	aux.ep = ep;
+	if (index_probe (index, &hdr, aux.hash, bucket, slot_matches_name, &aux,
+				&b, &s)) {
+		*ofsp = bucket[s].ofs - 1;
+		found = true;
+	}
+	free (bucket);
+	return found;
+}
+
+/* INDEX에 해시 H, 엔트리 오프셋 OFS인 슬롯을 넣음
+ * 헤더는 HDR에서만 갱신하며 디스크에 쓰지 않음 */
+static bool
+index_insert (struct inode *index, struct index_header *hdr, uint32_t h,
+		off_t ofs) {
+	struct index_slot *bucket = malloc (DISK_SECTOR_SIZE);
+	bool success = false;
+	uint32_t b;
+	size_t s;
+
+	if (bucket == NULL)
+		return false;
+	if (index_probe (index, hdr, h, bucket, slot_is_free, NULL, &b, &s)) {
+		if (bucket[s].ofs == 0)
+			hdr->used_cnt++;
+		bucket[s].hash = h;
+		bucket[s].ofs = ofs + 1;
+		success = inode_write_at (index, bucket, DISK_SECTOR_SIZE,
+				bucket_ofs (b)) == DISK_SECTOR_SIZE;
+	}
+	free (bucket);
+	return success;
+}
+
+/* INDEX에서 해시 H, 엔트리 오프셋 OFS인 슬롯을 묘비로 바꿈 */
+static void
+index_delete (struct inode *index, const struct index_header *hdr,
+		uint32_t h, off_t ofs) {
+	struct index_slot *bucket = malloc (DISK_SECTOR_SIZE);
+	uint32_t target = ofs + 1;
+	uint32_t b;
+	size_t s;
+
+	if (bucket == NULL)
+		return;
+	if (index_probe (index, hdr, h, bucket, slot_has_ofs, &target, &b, &s)) {
+		bucket[s].ofs = SLOT_TOMB;
+		inode_write_at (index, bucket, DISK_SECTOR_SIZE, bucket_ofs (b));
+	}
+	free (bucket);
+}
+
+/* DIR의 엔트리들로 인덱스를 처음부터 다시 만듦
+ * 인덱스가 아직 없으면 인덱스 inode를 만들어 DIR에 연결
+ * 버킷 수는 엔트리 수의 두 배 이상의 슬롯을 갖도록 정하며, 빈
+ * 엔트리들로 빈 엔트리 리스트도 다시 만듦 */
+static bool
+index_build (struct dir *dir) {
+	static struct index_slot zeros[BUCKET_SLOTS];
+	disk_sector_t sector = inode_get_index (dir->inode);
+	size_t entry_cnt = inode_length (dir->inode) / sizeof (struct dir_entry);
+	bool created = false;
+	struct index_header hdr;
+	struct inode *index;
+	struct dir_entry e;
+	off_t ofs;
+	uint32_t b;
+
+	if (sector == 0) {
+		if (!inode_alloc_sector (&sector))
+			return false;
+		if (!inode_create (sector, 0)) {
+			inode_free_sector (sector);
+			return false;
+		}
+		created = true;
+	}
+	index = inode_open (sector);
+	if (index == NULL) {
+		if (created)
+			inode_free_sector (sector);
+		return false;
+	}
+
+	hdr.magic = DIR_INDEX_MAGIC;
+	hdr.bucket_cnt = 4;
+	while (hdr.bucket_cnt * BUCKET_SLOTS < 2 * entry_cnt)
+		hdr.bucket_cnt *= 2;
+	hdr.used_cnt = 0;
+	hdr.free_head = 0;
+
+	for (b = 0; b < hdr.bucket_cnt; b++)
+		if (inode_write_at (index, zeros, sizeof zeros, bucket_ofs (b))
+				!= sizeof zeros)
+			goto fail;
+
+	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+			ofs += sizeof e) {
+		if (e.in_use) {
+			if (!index_insert (index, &hdr, hash_string (e.name), ofs))
+				goto fail;
+		} else {
+			e.inode_sector = hdr.free_head;
+			if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+				goto fail;
+			hdr.free_head = ofs + 1;
+		}
+	}
+	if (!index_write_header (index, &hdr))
+		goto fail;
+
+	if (created)
+		inode_set_index (dir->inode, sector);
+	inode_close (index);
+	return true;
+
+fail:
+	/* 새로 만든 인덱스는 버리고, 있던 인덱스는 쓸 수 없으므로 떼어 냄 */
+	if (!created)
+		inode_set_index (dir->inode, 0);
+	inode_remove (index);
+	inode_close (index);
+	return false;
+}
+
+/* 인덱스 INDEX를 가진 DIR에 NAME 엔트리를 추가
+ * 빈 엔트리 리스트에서 자리를 꺼내고, 없으면 디렉토리 끝에 붙임
+ * 슬롯이 3/4 넘게 차면 인덱스를 다시 만듦
+ * 실패하면 사용 중인 엔트리를 남기지 않고 빈 엔트리 리스트도 되돌림.
+ * 호출자는 실패하면 INODE_SECTOR를 해제하기 때문 */
+static bool
+index_add (struct dir *dir, struct inode *index, const char *name,
+		disk_sector_t inode_sector) {
+	struct index_header hdr;
+	struct dir_entry e, old;
+	uint32_t h = hash_string (name);
+	bool reused = false;
+	off_t ofs;
+
+	if (!index_read_header (index, &hdr))
+		return false;
+
+	ofs = inode_length (dir->inode);
+	if (hdr.free_head != 0
+			&& inode_read_at (dir->inode, &old, sizeof old, hdr.free_head - 1)
+				== sizeof old
+			&& !old.in_use) {
+		ofs = hdr.free_head - 1;
+		hdr.free_head = old.inode_sector;
+		reused = true;
+	} else
+		memset (&old, 0, sizeof old);
+
+	e.in_use = true;
+	strlcpy (e.name, name, sizeof e.name);
+	e.inode_sector = inode_sector;
+
+	/* 다시 만들 때는 엔트리를 먼저 써 두어야 인덱스에 들어감 */
+	if ((hdr.used_cnt + 1) * 4 > hdr.bucket_cnt * BUCKET_SLOTS * 3) {
+		if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+			return false;
+		if (index_build (dir))
+			return true;
+		/* 인덱스가 떼어졌으므로 엔트리는 선형으로 찾을 수 있음 */
+		if (inode_get_index (dir->inode) == 0)
+			return true;
+		/* 인덱스를 열지도 못했으면 빈 엔트리 리스트는 그대로이므로
+		 * 엔트리만 원래대로 돌려놓음 */
+		inode_write_at (dir->inode, &old, sizeof old, ofs);
+		return false;
+	}
+
+	/* 슬롯과 헤더를 먼저 쓰고 엔트리를 마지막에 씀. 슬롯은 엔트리가
+	 * 사용 중이고 이름이 같을 때만 맞으므로 먼저 써도 보이지 않음 */
+	if (!index_insert (index, &hdr, h, ofs)
+			|| !index_write_header (index, &hdr))
+		goto fail;
+	if (inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e)
+		return true;
+	if (reused) {
+		hdr.free_head = ofs + 1;
+		index_write_header (index, &hdr);
+	}
+
+fail:
+	index_delete (index, &hdr, h, ofs);
+	return false;
+}
+
+/* 인덱스 INDEX를 가진 DIR에서 OFS에 있는 엔트리 E를 지우고
+ * 빈 엔트리 리스트에 넣음 */
+static bool
+index_remove (struct dir *dir, struct inode *index, struct dir_entry *e,
+		off_t ofs) {
+	struct index_header hdr;
+
+	if (!index_read_header (index, &hdr))
+		return false;
+
+	index_delete (index, &hdr, hash_string (e->name), ofs);
+	e->in_use = false;
+	e->inode_sector = hdr.free_head;
+	if (inode_write_at (dir->inode, e, sizeof *e, ofs) != sizeof *e)
+		return false;
+	hdr.free_head = ofs + 1;
+	return index_write_header (index, &hdr);
+}
+
 /* 주어진 SECTOR에 ENTRY_CNT 개의 엔트리를 위한 공간을 가진 디렉토리를 생성
  * 성공하면 true, 실패하면 false를 반환 */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
+	dcache_invalidate_dir (sector);
 	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
 }
 
@@ -79,11 +436,28 @@ static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
 	struct dir_entry e;
+	struct inode *index;
 	size_t ofs;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	/* 인덱스가 있으면 인덱스로 찾음 */
+	index = index_open (dir);
+	if (index != NULL) {
+		off_t index_ofs;
+		bool found = index_find (dir, index, name, &e, &index_ofs);
+
+		inode_close (index);
+		if (found) {
+			if (ep != NULL)
+				*ep = e;
+			if (ofsp != NULL)
+				*ofsp = index_ofs;
+		}
+		return found;
+	}
+
 	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 			ofs += sizeof e)
 		if (e.in_use && !strcmp (name, e.name)) {
@@ -103,13 +477,21 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	disk_sector_t parent, sector;
 	struct dir_entry e;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
+	/* 디렉토리 엔트리 캐시에 있으면 디렉토리를 읽지 않음 */
+	parent = inode_get_inumber (dir->inode);
+	if (!dcache_lookup (parent, name, &sector)) {
+		sector = lookup (dir, name, &e, NULL) ? e.inode_sector : 0;
+		dcache_insert (parent, name, sector);
+	}
+
+	if (sector != 0)
+		*inode = inode_open (sector);
 	else
 		*inode = NULL;
 
@@ -123,6 +505,7 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	struct dir_entry e;
+	struct inode *index;
 	off_t ofs;
 	bool success = false;
 
@@ -137,6 +520,14 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
 
+	/* 인덱스가 있으면 인덱스를 통해 추가 */
+	index = index_open (dir);
+	if (index != NULL) {
+		success = index_add (dir, index, name, inode_sector);
+		inode_close (index);
+		goto done;
+	}
+
 	/* OFS를 빈 슬롯의 오프셋으로 설정
 	 * 빈 슬롯이 없으면 현재 파일 끝으로 설정됨
 
@@ -154,7 +545,14 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
+	/* 엔트리가 많아졌으면 인덱스를 만듦. 실패해도 선형 탐색은 됨 */
+	if (success && inode_length (dir->inode) / (off_t) sizeof e
+			> DIR_INDEX_MIN_ENTRIES)
+		index_build (dir);
+
 done:
+	if (success)
+		dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
 	return success;
 }
 
@@ -165,6 +563,7 @@ bool
 dir_remove (struct dir *dir, const char *name) {
 	struct dir_entry e;
 	struct inode *inode = NULL;
+	struct inode *index;
 	bool success = false;
 	off_t ofs;
 
@@ -181,12 +580,22 @@ dir_remove (struct dir *dir, const char *name) {
 		goto done;
 
 	/* 디렉토리 엔트리 지우기 */
-	e.in_use = false;
-	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
-		goto done;
+	index = index_open (dir);
+	if (index != NULL) {
+		bool removed = index_remove (dir, index, &e, ofs);
+
+		inode_close (index);
+		if (!removed)
+			goto done;
+	} else {
+		e.in_use = false;
+		if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+			goto done;
+	}
 
 	/* inode 제거 */
 	inode_remove (inode);
+	dcache_insert (inode_get_inumber (dir->inode), name, 0);
 	success = true;
 
 done:
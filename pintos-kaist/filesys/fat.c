@@ -1,8 +1,12 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include <limits.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -16,18 +20,43 @@ struct fat_boot {
 	unsigned int root_dir_cluster;
 };
 
-/* FAT 파일시스템 */
+/* 빈 클러스터 요약에서 한 그룹의 클러스터 수 */
+#define FAT_GROUP_SIZE 1024
+
+/* FAT 섹터 하나에 든 항목 수 */
+#define FAT_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
+/* 아직 FAT을 읽어 세지 않은 그룹의 GROUP_FREE 값 */
+#define GROUP_UNKNOWN UINT_MAX
+
+/* FAT 파일시스템
+ * FAT 자체는 메모리에 두지 않고 페이지 캐시를 통해 섹터 단위로 읽고
+ * 씀. 바뀐 FAT 섹터만 더티가 되어 플러시 스레드와 filesys_done()이
+ * 디스크에 씀 */
 struct fat_fs {
 	struct fat_boot bs;
-	unsigned int *fat;
 	unsigned int fat_length;
 	disk_sector_t data_start;
 	cluster_t last_clst;
 	struct lock write_lock;
+
+	/* 빈 클러스터 요약. FAT 값이 0이 아닌 클러스터의 비트가 켜져 있고,
+	 * 그룹마다 빈 클러스터 수를 셈. 그룹은 할당이 처음 살펴볼 때 FAT을
+	 * 읽어 채우며, 그 뒤로는 fat_put()이 갱신함 */
+	struct bitmap *used_map;
+	unsigned int *group_free;
+	unsigned int group_cnt;
 };
 
 static struct fat_fs *fat_fs;
 
+/* 통계 */
+static long long alloc_cnt;             /* 할당한 클러스터 수 */
+static long long contig_cnt;            /* 체인의 바로 다음 클러스터였던 할당 */
+static long long scan_cnt;              /* 할당 때 훑은 그룹 수 */
+
+static void fat_summary_init (void);
+
 void fat_boot_create (void);
 void fat_fs_init (void);
 
@@ -37,11 +66,11 @@ fat_init (void) {
 	if (fat_fs == NULL)
 		PANIC ("FAT init failed");
 
-	// 디스크에서 부트 섹터 읽기
+	// 부트 섹터 읽기
 	unsigned int *bounce = malloc (DISK_SECTOR_SIZE);
 	if (bounce == NULL)
 		PANIC ("FAT init failed");
-	disk_read (filesys_disk, FAT_BOOT_SECTOR, bounce);
+	page_cache_read (FAT_BOOT_SECTOR, bounce);
 	memcpy (&fat_fs->bs, bounce, sizeof (fat_fs->bs));
 	free (bounce);
 
@@ -53,86 +82,41 @@ fat_init (void) {
 
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
-
-	// 디스크에서 직접 FAT 로드
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
-	}
+	// FAT은 필요할 때 페이지 캐시로 읽으므로 요약만 준비
+	fat_summary_init ();
 }
 
 void
 fat_close (void) {
 	// FAT 부트 섹터 쓰기
+	// 더티 FAT 섹터는 filesys_done()의 페이지 캐시 플러시가 씀
 	uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
 	if (bounce == NULL)
 		PANIC ("FAT close failed");
 	memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
-	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
+	page_cache_write (FAT_BOOT_SECTOR, bounce);
 	free (bounce);
-
-	// FAT를 디스크에 직접 쓰기
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
 }
 
 void
 fat_create (void) {
+	static uint8_t zeros[DISK_SECTOR_SIZE];
+	unsigned int i;
+
 	// FAT 부트 생성
 	fat_boot_create ();
 	fat_fs_init ();
 
-	// FAT 테이블 생성
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
+	// FAT 테이블을 0으로 채우기
+	for (i = 0; i < fat_fs->bs.fat_sectors; i++)
+		page_cache_write (fat_fs->bs.fat_start + i, zeros);
 
 	// ROOT_DIR_CLST 설정
+	fat_summary_init ();
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
 
 	// ROOT_DIR_CLUSTER 영역을 0으로 채우기
-	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
-	if (buf == NULL)
-		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
-	free (buf);
+	page_cache_write (cluster_to_sector (ROOT_DIR_CLUSTER), zeros);
 }
 
 void
@@ -152,7 +136,116 @@ fat_boot_create (void) {
 
 void
 fat_fs_init (void) {
-	/* TODO: 여기에 코드를 작성하세요. */
+	unsigned int data_clusters;
+
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+
+	/* 클러스터 0은 쓰지 않으며, 데이터 영역은 클러스터 1부터 시작 */
+	data_clusters = (fat_fs->bs.total_sectors - fat_fs->data_start)
+		/ SECTORS_PER_CLUSTER;
+	fat_fs->fat_length = data_clusters + 1;
+	if (fat_fs->fat_length
+			> fat_fs->bs.fat_sectors * DISK_SECTOR_SIZE / sizeof (cluster_t))
+		fat_fs->fat_length =
+			fat_fs->bs.fat_sectors * DISK_SECTOR_SIZE / sizeof (cluster_t);
+
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	lock_init (&fat_fs->write_lock);
+}
+
+/* 빈 클러스터 요약을 모든 그룹이 아직 세지 않은 상태로 만듦 */
+static void
+fat_summary_init (void) {
+	unsigned int g;
+
+	if (fat_fs->used_map != NULL) {
+		bitmap_destroy (fat_fs->used_map);
+		free (fat_fs->group_free);
+	}
+
+	fat_fs->used_map = bitmap_create (fat_fs->fat_length);
+	fat_fs->group_cnt = DIV_ROUND_UP (fat_fs->fat_length, FAT_GROUP_SIZE);
+	fat_fs->group_free = calloc (fat_fs->group_cnt, sizeof (unsigned int));
+	if (fat_fs->used_map == NULL || fat_fs->group_free == NULL)
+		PANIC ("FAT free cluster summary creation failed");
+
+	for (g = 0; g < fat_fs->group_cnt; g++)
+		fat_fs->group_free[g] = GROUP_UNKNOWN;
+}
+
+/* 그룹 G의 FAT 항목들을 읽어 빈 클러스터 요약을 채움
+ * FAT 섹터를 한 번에 하나씩 읽음 */
+static void
+fat_group_load (unsigned int g) {
+	cluster_t entries[FAT_PER_SECTOR];
+	cluster_t clst = g * FAT_GROUP_SIZE;
+	cluster_t end = clst + FAT_GROUP_SIZE;
+	unsigned int free_cnt = 0;
+
+	if (end > fat_fs->fat_length)
+		end = fat_fs->fat_length;
+	for (; clst < end; clst++) {
+		if (clst % FAT_PER_SECTOR == 0 || clst == g * FAT_GROUP_SIZE)
+			page_cache_read (fat_fs->bs.fat_start + clst / FAT_PER_SECTOR,
+					entries);
+
+		/* 클러스터 0은 항상 사용 중으로 둠 */
+		if (clst == 0 || entries[clst % FAT_PER_SECTOR] != 0)
+			bitmap_mark (fat_fs->used_map, clst);
+		else {
+			bitmap_reset (fat_fs->used_map, clst);
+			free_cnt++;
+		}
+	}
+	fat_fs->group_free[g] = free_cnt;
+}
+
+/* 빈 클러스터 하나를 찾아 반환. 빈 클러스터가 없으면 0을 반환
+ * HINT가 비어 있으면 HINT를 고르고, 아니면 HINT가 속한 그룹부터
+ * 빈 클러스터가 남은 그룹을 차례로 살펴 그 안에서 찾음
+ * 그룹별 빈 클러스터 수 덕분에 꽉 찬 그룹은 훑지 않으며, 아직 세지
+ * 않은 그룹은 살펴볼 때 FAT을 읽어 셈 */
+static cluster_t
+fat_find_free (cluster_t hint) {
+	unsigned int g, i;
+
+	if (hint == 0 || hint >= fat_fs->fat_length)
+		hint = 1;
+	if (fat_fs->group_free[hint / FAT_GROUP_SIZE] == GROUP_UNKNOWN)
+		fat_group_load (hint / FAT_GROUP_SIZE);
+	if (!bitmap_test (fat_fs->used_map, hint))
+		return hint;
+
+	g = hint / FAT_GROUP_SIZE;
+	for (i = 0; i <= fat_fs->group_cnt; i++, g = (g + 1) % fat_fs->group_cnt) {
+		size_t start = i == 0 ? hint : g * FAT_GROUP_SIZE;
+		size_t clst;
+
+		scan_cnt++;
+		if (fat_fs->group_free[g] == GROUP_UNKNOWN)
+			fat_group_load (g);
+		if (fat_fs->group_free[g] == 0)
+			continue;
+		clst = bitmap_scan (fat_fs->used_map, start, 1, false);
+		if (clst != BITMAP_ERROR && clst / FAT_GROUP_SIZE == g)
+			return clst;
+	}
+	return 0;
+}
+
+/* FAT 통계를 출력 */
+void
+fat_print_stats (void) {
+	unsigned int g, loaded = 0;
+
+	if (fat_fs == NULL || fat_fs->used_map == NULL)
+		return;
+	for (g = 0; g < fat_fs->group_cnt; g++)
+		if (fat_fs->group_free[g] != GROUP_UNKNOWN)
+			loaded++;
+	printf ("FAT: %u of %u groups loaded, %lld clusters allocated "
+			"(%lld contiguous), %lld groups scanned\n",
+			loaded, fat_fs->group_cnt, alloc_cnt, contig_cnt, scan_cnt);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -161,33 +254,90 @@ fat_fs_init (void) {
 
 /* 체인에 클러스터를 추가
  * CLST가 0이면 새로운 체인을 시작
- * 새로운 클러스터 할당에 실패하면 0을 반환 */
+ * 새로운 클러스터 할당에 실패하면 0을 반환
+ * 체인이 연속되도록 CLST 바로 다음 클러스터를 먼저 시도하고, 새
+ * 체인이면 마지막으로 할당한 클러스터 다음부터 찾음 */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: 여기에 코드를 작성하세요. */
+	cluster_t new;
+
+	lock_acquire (&fat_fs->write_lock);
+	new = fat_find_free (clst != 0 ? clst + 1 : fat_fs->last_clst + 1);
+	if (new != 0) {
+		fat_put (new, EOChain);
+		if (clst != 0)
+			fat_put (clst, new);
+		fat_fs->last_clst = new;
+		alloc_cnt++;
+		if (clst != 0 && new == clst + 1)
+			contig_cnt++;
+	}
+	lock_release (&fat_fs->write_lock);
+	return new;
 }
 
 /* CLST에서 시작하는 클러스터 체인을 제거
  * PCLST가 0이면 CLST를 체인의 시작으로 간주 */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: 여기에 코드를 작성하세요. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0)
+		fat_put (pclst, EOChain);
+	while (clst != 0 && clst != EOChain && clst < fat_fs->fat_length) {
+		cluster_t next = fat_get (clst);
+
+		fat_put (clst, 0);
+		clst = next;
+	}
+	lock_release (&fat_fs->write_lock);
 }
 
-/* FAT 테이블의 값을 업데이트 */
+/* FAT 테이블의 값을 업데이트
+ * 해당 FAT 섹터는 페이지 캐시에서 더티가 됨
+ * 그룹을 이미 세었다면 빈 클러스터 요약도 함께 갱신 */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: 여기에 코드를 작성하세요. */
+	unsigned int g = clst / FAT_GROUP_SIZE;
+	cluster_t old;
+
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+
+	old = fat_get (clst);
+	page_cache_write_at (fat_fs->bs.fat_start + clst / FAT_PER_SECTOR, &val,
+			clst % FAT_PER_SECTOR * sizeof val, sizeof val);
+	if (fat_fs->group_free[g] == GROUP_UNKNOWN)
+		return;
+	if (old == 0 && val != 0) {
+		bitmap_mark (fat_fs->used_map, clst);
+		fat_fs->group_free[g]--;
+	} else if (old != 0 && val == 0) {
+		bitmap_reset (fat_fs->used_map, clst);
+		fat_fs->group_free[g]++;
+	}
 }
 
-/* FAT 테이블의 값을 가져오기 */
+/* FAT 테이블의 값을 가져오기
+ * 해당 FAT 섹터를 페이지 캐시에서 읽음 */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: 여기에 코드를 작성하세요. */
+	cluster_t val;
+
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+	page_cache_read_at (fat_fs->bs.fat_start + clst / FAT_PER_SECTOR, &val,
+			clst % FAT_PER_SECTOR * sizeof val, sizeof val);
+	return val;
 }
 
 /* 클러스터 번호를 섹터 번호로 변환 */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: 여기에 코드를 작성하세요. */
+	ASSERT (clst > 0);
+	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
+}
+
+/* 섹터 번호를 그 섹터가 속한 클러스터 번호로 변환 */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	return (sector - fat_fs->data_start) / SECTORS_PER_CLUSTER + 1;
 }
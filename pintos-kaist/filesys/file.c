@@ -3,11 +3,20 @@
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* 미리 읽기 창의 처음 크기와 최대 크기 (바이트) */
+#define RA_MIN_BYTES (2 * DISK_SECTOR_SIZE)
+#define RA_MAX_BYTES (32 * DISK_SECTOR_SIZE)
+
 /* 열린 파일 구조체 */
 struct file {
 	struct inode *inode;        /* 파일의 inode */
 	off_t pos;                  /* 현재 위치 */
 	bool deny_write;            /* file_deny_write()가 호출되었는가? */
+
+	/* 미리 읽기 상태 */
+	off_t ra_prev;              /* 직전 file_read()가 끝난 위치 */
+	off_t ra_end;               /* 미리 읽기를 요청해 둔 끝 위치 */
+	off_t ra_window;            /* 미리 읽기 창 크기, 0이면 꺼짐 */
 };
 
 /* 주어진 INODE에 대한 파일을 열고, 해당 inode의 소유권을 가져가며
@@ -64,6 +73,33 @@ file_get_inode (struct file *file) {
 	return file->inode;
 }
 
+/* FILE의 POS에서 시작한 읽기가 끝난 뒤 미리 읽기 창을 조정
+ * 직전 읽기가 끝난 곳에서 이어 읽으면 순차 접근으로 보고 창을 두 배로
+ * 늘린 뒤, 아직 요청하지 않은 창 안의 섹터들을 미리 읽도록 요청
+ * 그렇지 않으면 임의 접근으로 보고 창을 닫음 */
+static void
+file_readahead (struct file *file, off_t pos) {
+	off_t start, end;
+
+	if (pos != file->ra_prev) {
+		file->ra_window = 0;
+		file->ra_end = 0;
+		return;
+	}
+
+	if (file->ra_window == 0)
+		file->ra_window = RA_MIN_BYTES;
+	else if (file->ra_window < RA_MAX_BYTES)
+		file->ra_window *= 2;
+
+	start = file->pos > file->ra_end ? file->pos : file->ra_end;
+	end = file->pos + file->ra_window;
+	if (start < end) {
+		inode_readahead (file->inode, start, end - start);
+		file->ra_end = end;
+	}
+}
+
 /* FILE에서 SIZE 바이트를 BUFFER로 읽어옴
  * 파일의 현재 위치에서 시작
  * 실제로 읽은 바이트 수를 반환하며,
@@ -71,8 +107,11 @@ file_get_inode (struct file *file) {
  * 읽은 바이트 수만큼 FILE의 위치를 전진시킴 */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t pos = file->pos;
+	off_t bytes_read = inode_read_at (file->inode, buffer, size, pos);
 	file->pos += bytes_read;
+	file_readahead (file, pos);
+	file->ra_prev = file->pos;
 	return bytes_read;
 }
 
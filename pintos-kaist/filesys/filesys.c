@@ -2,10 +2,13 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/dcache.h"
+#include "filesys/fat.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/page_cache.h"
 #include "devices/disk.h"
 
 /* 파일시스템을 포함하는 디스크 */
@@ -21,7 +24,9 @@ filesys_init (bool format) {
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
+	page_cache_init ();
 	inode_init ();
+	dcache_init ();
 
 #ifdef EFILESYS
 	fat_init ();
@@ -51,6 +56,7 @@ filesys_done (void) {
 #else
 	free_map_close ();
 #endif
+	page_cache_flush ();
 }
 
 /* 주어진 INITIAL_SIZE로 NAME이라는 이름의 파일을 생성
@@ -62,11 +68,11 @@ filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
 	struct dir *dir = dir_open_root ();
 	bool success = (dir != NULL
-			&& free_map_allocate (1, &inode_sector)
+			&& inode_alloc_sector (&inode_sector)
 			&& inode_create (inode_sector, initial_size)
 			&& dir_add (dir, name, inode_sector));
 	if (!success && inode_sector != 0)
-		free_map_release (inode_sector, 1);
+		inode_free_sector (inode_sector);
 	dir_close (dir);
 
 	return success;
@@ -108,8 +114,11 @@ do_format (void) {
 	printf ("Formatting file system...");
 
 #ifdef EFILESYS
-	/* FAT를 생성하고 디스크에 저장 */
+	/* FAT를 생성하고 루트 디렉터리 클러스터에 루트 디렉터리를 만든
+	 * 다음 디스크에 저장 */
 	fat_create ();
+	if (!dir_create (ROOT_DIR_SECTOR, 16))
+		PANIC ("root directory creation failed");
 	fat_close ();
 #else
 	free_map_create ();
@@ -35,6 +35,27 @@ free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
 	return sector != BITMAP_ERROR;
 }
 
+/* SECTOR부터 이어지는 빈 섹터를 최대 CNT개까지 할당하고
+ * 할당한 섹터 수를 반환. SECTOR가 이미 사용 중이면 0을 반환
+ * 파일을 늘릴 때 마지막 블록 바로 뒤를 이어 받는 데 씀 */
+size_t
+free_map_allocate_at (disk_sector_t sector, size_t cnt) {
+	size_t n = 0;
+
+	while (n < cnt && sector + n < bitmap_size (free_map)
+			&& !bitmap_test (free_map, sector + n))
+		n++;
+	if (n == 0)
+		return 0;
+
+	bitmap_set_multiple (free_map, sector, n, true);
+	if (free_map_file != NULL && !bitmap_write (free_map, free_map_file)) {
+		bitmap_set_multiple (free_map, sector, n, false);
+		return 0;
+	}
+	return n;
+}
+
 /* SECTOR에서 시작하는 CNT개의 섹터를 사용 가능하게 만듦 */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
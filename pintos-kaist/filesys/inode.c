@@ -1,22 +1,71 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* inode를 식별 */
 #define INODE_MAGIC 0x494e4f44
 
+/* 닫힌 뒤에도 메모리에 남겨 두는 inode 수 */
+#define INODE_CACHE_MAX 64
+
+/* inode 섹터에 직접 담는 익스텐트 수 */
+#define INLINE_EXTENTS 40
+
+/* 넘친 익스텐트 블록 하나에 담는 익스텐트 수 */
+#define BLOCK_EXTENTS 42
+
+/* inode 섹터에 내용을 직접 담을 수 있는 최대 파일 크기 (바이트) */
+#define INLINE_MAX (INLINE_EXTENTS * sizeof (struct extent))
+
+/* struct inode_disk의 FLAGS */
+#define INODE_INLINE 0x1                /* 내용이 inode 섹터 안에 있음 */
+
+/* 익스텐트: 파일의 논리 섹터 LSEC부터 CNT개가 디스크의 START부터
+ * 연속으로 놓여 있음 */
+struct extent {
+	uint32_t lsec;                      /* 첫 논리 섹터 */
+	disk_sector_t start;                /* 첫 디스크 섹터 */
+	uint32_t cnt;                       /* 섹터 수 */
+};
+
 /* 디스크상의 inode
- * 정확히 DISK_SECTOR_SIZE 바이트 길이여야 함 */
+ * 정확히 DISK_SECTOR_SIZE 바이트 길이여야 함
+ * 익스텐트는 논리 섹터 순서이고 빈틈 없이 이어짐. 앞의
+ * INLINE_EXTENTS개는 inode 안에, 나머지는 OVERFLOW에서 시작하는
+ * 익스텐트 블록 체인에 있음
+ * INODE_INLINE이 켜져 있으면 익스텐트 대신 파일 내용 자체가 그 자리에
+ * 들어 있고 데이터 섹터는 없음. INLINE_MAX를 넘게 자라면 데이터
+ * 섹터로 옮겨지며, 다시 돌아오지는 않음 */
 struct inode_disk {
-	disk_sector_t start;                /* 첫 번째 데이터 섹터 */
 	off_t length;                       /* 파일 크기(바이트) */
 	unsigned magic;                     /* 매직 넘버 */
-	uint32_t unused[125];               /* 사용되지 않음 */
+	uint32_t extent_cnt;                /* 전체 익스텐트 수 */
+	disk_sector_t overflow;             /* 첫 익스텐트 블록, 없으면 0 */
+	union {
+		struct extent extents[INLINE_EXTENTS];  /* 앞쪽 익스텐트들 */
+		uint8_t inline_data[INLINE_MAX];        /* 인라인 파일 내용 */
+	};
+	uint32_t flags;                     /* INODE_* 플래그 */
+	disk_sector_t index;                /* 디렉터리 인덱스 inode, 없으면 0 */
+	uint32_t unused[2];                 /* 사용되지 않음 */
+};
+
+/* 넘친 익스텐트 블록
+ * 정확히 DISK_SECTOR_SIZE 바이트 길이여야 함 */
+struct extent_block {
+	disk_sector_t next;                 /* 다음 익스텐트 블록, 없으면 0 */
+	uint32_t unused;                    /* 사용되지 않음 */
+	struct extent extents[BLOCK_EXTENTS];
 };
 
 /* SIZE 바이트 길이의 inode에 할당할 섹터 수를 반환 */
@@ -27,34 +76,419 @@ bytes_to_sectors (off_t size) {
 
 /* 메모리상의 inode */
 struct inode {
-	struct list_elem elem;              /* inode 리스트의 요소 */
+	struct hash_elem elem;              /* inode 테이블의 요소 */
+	struct list_elem lru_elem;          /* 닫힌 inode LRU 리스트의 요소 */
 	disk_sector_t sector;               /* 디스크 위치의 섹터 번호 */
 	int open_cnt;                       /* 열린 횟수 */
 	bool removed;                       /* 삭제되면 true, 그렇지 않으면 false */
 	int deny_write_cnt;                 /* 0: 쓰기 허용, >0: 쓰기 거부 */
+	struct lock lock;                   /* 익스텐트와 길이를 보호 */
+	struct extent *extents;             /* 모든 익스텐트, 논리 섹터 순 */
+	size_t extent_cap;                  /* EXTENTS 배열의 용량 */
 	struct inode_disk data;             /* inode 내용 */
 };
 
+/* INODE의 내용이 inode 섹터 안에 있으면 true를 반환 */
+static inline bool
+inode_is_inline (const struct inode *inode) {
+	return (inode->data.flags & INODE_INLINE) != 0;
+}
+
+/* INODE에 할당된 데이터 섹터 수를 반환 */
+static size_t
+inode_sectors (const struct inode *inode) {
+	const struct extent *last;
+
+	if (inode->data.extent_cnt == 0)
+		return 0;
+	last = &inode->extents[inode->data.extent_cnt - 1];
+	return last->lsec + last->cnt;
+}
+
+/* INODE의 논리 섹터 LSEC가 놓인 디스크 섹터를 익스텐트에서 이진
+ * 탐색으로 찾아 반환. 할당되지 않았으면 -1을 반환 */
+static disk_sector_t
+lsec_to_sector (const struct inode *inode, size_t lsec) {
+	size_t lo = 0, hi = inode->data.extent_cnt;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		const struct extent *e = &inode->extents[mid];
+
+		if (lsec < e->lsec)
+			hi = mid;
+		else if (lsec >= e->lsec + e->cnt)
+			lo = mid + 1;
+		else
+			return e->start + (lsec - e->lsec);
+	}
+	return -1;
+}
+
 /* INODE 내의 바이트 오프셋 POS를 포함하는 디스크 섹터를 반환
  * INODE가 오프셋 POS의 바이트에 대한 데이터를 포함하지 않으면
  * -1을 반환 */
 static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
+	if (pos < inode->data.length && !inode_is_inline (inode))
+		return lsec_to_sector (inode, pos / DISK_SECTOR_SIZE);
 	else
 		return -1;
 }
 
-/* 열린 inode들의 리스트, 단일 inode를 두 번 여는 것이
- * 동일한 'struct inode'를 반환하도록 함 */
-static struct list open_inodes;
+/* INODE의 익스텐트 배열에 익스텐트 하나를 더 담을 자리를 마련
+ * 메모리가 부족하면 false를 반환 */
+static bool
+extents_reserve (struct inode *inode) {
+	struct extent *extents;
+	size_t cap;
+
+	if (inode->data.extent_cnt < inode->extent_cap)
+		return true;
+	cap = inode->extent_cap * 2;
+	extents = realloc (inode->extents, cap * sizeof *extents);
+	if (extents == NULL)
+		return false;
+	inode->extents = extents;
+	inode->extent_cap = cap;
+	return true;
+}
+
+/* 디스크에서 INODE의 익스텐트를 모두 읽어 메모리 배열에 담음
+ * 메모리가 부족하면 false를 반환 */
+static bool
+inode_load_extents (struct inode *inode) {
+	size_t n = inode->data.extent_cnt;
+	size_t i = n < INLINE_EXTENTS ? n : INLINE_EXTENTS;
+	disk_sector_t sector = inode->data.overflow;
+	struct extent_block *blk = NULL;
+
+	inode->extent_cap = n > INLINE_EXTENTS ? n : INLINE_EXTENTS;
+	inode->extents = malloc (inode->extent_cap * sizeof *inode->extents);
+	if (inode->extents == NULL)
+		return false;
+	memcpy (inode->extents, inode->data.extents, i * sizeof *inode->extents);
+
+	if (i < n) {
+		blk = malloc (sizeof *blk);
+		if (blk == NULL) {
+			free (inode->extents);
+			return false;
+		}
+	}
+	while (i < n) {
+		size_t k = n - i < BLOCK_EXTENTS ? n - i : BLOCK_EXTENTS;
+
+		page_cache_read (sector, blk);
+		memcpy (inode->extents + i, blk->extents, k * sizeof *blk->extents);
+		i += k;
+		sector = blk->next;
+	}
+	free (blk);
+	return true;
+}
+
+/* 섹터 하나를 할당해 *SECTORP에 저장. inode 섹터와 익스텐트 블록처럼
+ * 데이터가 아닌 섹터에 씀. EFILESYS에서는 클러스터 하나짜리 FAT 체인을,
+ * 아니면 프리 맵을 씀. 디스크가 가득 차면 false를 반환 */
+bool
+inode_alloc_sector (disk_sector_t *sectorp) {
+#ifdef EFILESYS
+	cluster_t clst = fat_create_chain (0);
+
+	if (clst == 0)
+		return false;
+	*sectorp = cluster_to_sector (clst);
+	return true;
+#else
+	return free_map_allocate (1, sectorp);
+#endif
+}
+
+/* inode_alloc_sector()로 할당한 SECTOR를 해제 */
+void
+inode_free_sector (disk_sector_t sector) {
+#ifdef EFILESYS
+	fat_remove_chain (sector_to_cluster (sector), 0);
+#else
+	free_map_release (sector, 1);
+#endif
+}
+
+/* INODE의 익스텐트와 길이를 inode 섹터와 익스텐트 블록에 씀
+ * 익스텐트 블록이 더 필요하면 할당하며, 할당에 실패하면 false를 반환 */
+static bool
+inode_save (struct inode *inode) {
+	struct inode_disk *d = &inode->data;
+	size_t n = d->extent_cnt;
+	size_t i = n < INLINE_EXTENTS ? n : INLINE_EXTENTS;
+	struct extent_block *blk = NULL;
+	disk_sector_t sector = d->overflow;
+	bool fresh = false;
+	bool success = true;
+
+	memcpy (d->extents, inode->extents, i * sizeof *d->extents);
+	if (i < n) {
+		blk = malloc (sizeof *blk);
+		if (blk == NULL)
+			return false;
+		if (sector == 0) {
+			if (!inode_alloc_sector (&sector)) {
+				free (blk);
+				return false;
+			}
+			d->overflow = sector;
+			fresh = true;
+		}
+	}
+
+	while (i < n) {
+		size_t k = n - i < BLOCK_EXTENTS ? n - i : BLOCK_EXTENTS;
+
+		if (fresh)
+			memset (blk, 0, sizeof *blk);
+		else
+			page_cache_read (sector, blk);
+		memcpy (blk->extents, inode->extents + i, k * sizeof *blk->extents);
+		i += k;
+
+		/* 다음 블록이 필요한데 아직 없으면 할당 */
+		fresh = false;
+		if (i < n && blk->next == 0) {
+			if (!inode_alloc_sector (&blk->next)) {
+				blk->next = 0;
+				success = false;
+			}
+			fresh = true;
+		}
+		page_cache_write (sector, blk);
+		if (!success)
+			break;
+		sector = blk->next;
+	}
+	free (blk);
+
+	if (success)
+		page_cache_write (inode->sector, d);
+	return success;
+}
+
+/* INODE의 논리 섹터 LSEC부터 끝까지의 데이터 섹터를 해제하고
+ * 익스텐트를 그만큼 줄임. 디스크의 inode는 갱신하지 않음
+ * EFILESYS에서는 데이터 섹터들이 논리 순서대로 하나의 FAT 체인을
+ * 이루므로, LSEC의 클러스터부터 체인 끝까지 한 번에 끊음 */
+static void
+inode_release_from (struct inode *inode, size_t lsec) {
+#ifdef EFILESYS
+	if (lsec < inode_sectors (inode))
+		fat_remove_chain (sector_to_cluster (lsec_to_sector (inode, lsec)),
+				lsec > 0
+				? sector_to_cluster (lsec_to_sector (inode, lsec - 1)) : 0);
+#endif
+	while (inode->data.extent_cnt > 0) {
+		struct extent *e = &inode->extents[inode->data.extent_cnt - 1];
+		size_t keep = e->lsec < lsec ? lsec - e->lsec : 0;
+
+		if (keep >= e->cnt)
+			break;
+#ifndef EFILESYS
+		free_map_release (e->start + keep, e->cnt - keep);
+#endif
+		if (keep > 0) {
+			e->cnt = keep;
+			break;
+		}
+		inode->data.extent_cnt--;
+	}
+}
+
+/* INODE 끝에 데이터 섹터를 최대 CNT개 연속으로 할당해 익스텐트에
+ * 붙이고, 첫 섹터를 *STARTP에 저장. 할당한 섹터 수를 반환하며, 디스크나
+ * 메모리가 부족하면 0을 반환
+ * 가능하면 마지막 익스텐트를 바로 뒤로 늘려 파일이 연속되게 하고,
+ * 그럴 수 없으면 새 익스텐트를 붙임. 프리 맵에서는 가장 긴 연속 빈
+ * 구간부터 찾고, EFILESYS에서는 파일의 마지막 클러스터에 클러스터
+ * 하나를 이어 붙임. FAT은 바로 다음 클러스터를 먼저 고르므로 대개
+ * 마지막 익스텐트가 늘어남 */
+static size_t
+inode_alloc_data (struct inode *inode, size_t cnt, disk_sector_t *startp) {
+	struct extent *last = NULL;
+	size_t got;
+
+	ASSERT (cnt > 0);
+
+	if (inode->data.extent_cnt > 0)
+		last = &inode->extents[inode->data.extent_cnt - 1];
+#ifdef EFILESYS
+	cluster_t prev = last != NULL
+		? sector_to_cluster (last->start + last->cnt - 1) : 0;
+	cluster_t clst = fat_create_chain (prev);
+
+	if (clst == 0)
+		return 0;
+	*startp = cluster_to_sector (clst);
+	got = 1;
+	if (last != NULL && *startp == last->start + last->cnt) {
+		last->cnt++;
+		return got;
+	}
+	if (!extents_reserve (inode)) {
+		fat_remove_chain (clst, prev);
+		return 0;
+	}
+#else
+	if (last != NULL) {
+		got = free_map_allocate_at (last->start + last->cnt, cnt);
+		if (got > 0) {
+			*startp = last->start + last->cnt;
+			last->cnt += got;
+			return got;
+		}
+	}
+	for (got = cnt; got > 0; got /= 2)
+		if (free_map_allocate (got, startp))
+			break;
+	if (got == 0)
+		return 0;
+	if (!extents_reserve (inode)) {
+		free_map_release (*startp, got);
+		return 0;
+	}
+#endif
+	inode->extents[inode->data.extent_cnt++] = (struct extent) {
+		.lsec = inode_sectors (inode),
+		.start = *startp,
+		.cnt = got,
+	};
+	return got;
+}
+
+/* INODE가 LENGTH 바이트를 담을 수 있도록 데이터 섹터를 할당하고
+ * 새 섹터를 0으로 채움. 길이는 바꾸지 않음
+ * 디스크나 메모리가 부족하면 새로 할당한 섹터를 모두 돌려놓고
+ * false를 반환. INODE의 락을 쥔 채로 호출해야 함 */
+static bool
+inode_grow (struct inode *inode, off_t length) {
+	static char zeros[DISK_SECTOR_SIZE];
+	size_t have = inode_sectors (inode);
+	size_t need = bytes_to_sectors (length);
+
+	if (need <= have)
+		return true;
+
+	while (inode_sectors (inode) < need) {
+		disk_sector_t start;
+		size_t got, i;
+
+		got = inode_alloc_data (inode, need - inode_sectors (inode), &start);
+		if (got == 0)
+			goto fail;
+		for (i = 0; i < got; i++)
+			page_cache_write (start + i, zeros);
+	}
+	if (inode_save (inode))
+		return true;
+
+fail:
+	inode_release_from (inode, have);
+	inode_save (inode);
+	return false;
+}
+
+/* 인라인 INODE의 내용을 데이터 섹터로 옮김
+ * 실패하면 INODE를 인라인 상태 그대로 두고 false를 반환
+ * INODE의 락을 쥔 채로 호출해야 함 */
+static bool
+inode_promote (struct inode *inode) {
+	off_t length = inode->data.length;
+	uint8_t *copy;
+	off_t ofs;
+
+	ASSERT (inode_is_inline (inode));
+
+	copy = malloc (INLINE_MAX);
+	if (copy == NULL)
+		return false;
+	memcpy (copy, inode->data.inline_data, INLINE_MAX);
+
+	memset (inode->data.inline_data, 0, INLINE_MAX);
+	inode->data.flags &= ~INODE_INLINE;
+	inode->data.extent_cnt = 0;
+	inode->data.overflow = 0;
+	if (!inode_grow (inode, length)) {
+		inode->data.flags |= INODE_INLINE;
+		memcpy (inode->data.inline_data, copy, INLINE_MAX);
+		page_cache_write (inode->sector, &inode->data);
+		free (copy);
+		return false;
+	}
+
+	for (ofs = 0; ofs < length; ofs += DISK_SECTOR_SIZE) {
+		int chunk = length - ofs < DISK_SECTOR_SIZE
+			? length - ofs : DISK_SECTOR_SIZE;
+
+		page_cache_write_at (lsec_to_sector (inode, ofs / DISK_SECTOR_SIZE),
+				copy + ofs, 0, chunk);
+	}
+	page_cache_write (inode->sector, &inode->data);
+	free (copy);
+	return true;
+}
+
+/* 메모리에 있는 inode들의 섹터 번호 해시 테이블, 단일 inode를 두 번
+ * 여는 것이 동일한 'struct inode'를 반환하도록 함
+ * 열린 inode와 함께, 마지막 opener가 닫았지만 아직 내보내지 않은
+ * inode도 들어 있음. 그런 inode는 CLOSED_INODES에도 최근에 닫힌
+ * 순서로 들어 있고, INODE_CACHE_MAX개를 넘으면 가장 오래된 것부터
+ * 해제함. 다시 열 때 디스크를 읽지 않아도 됨 */
+static struct hash inode_table;
+static struct list closed_inodes;
+static size_t closed_cnt;
+static struct lock inode_table_lock;
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct inode, elem)->sector
+		< hash_entry (b, struct inode, elem)->sector;
+}
+
+/* inode 테이블에서 SECTOR의 inode를 찾아 반환, 없으면 null 포인터 */
+static struct inode *
+inode_lookup (disk_sector_t sector) {
+	struct inode key;
+	struct hash_elem *e;
+
+	key.sector = sector;
+	e = hash_find (&inode_table, &key.elem);
+	return e != NULL ? hash_entry (e, struct inode, elem) : NULL;
+}
+
+/* 닫힌 INODE를 inode 테이블과 LRU 리스트에서 빼고 해제 */
+static void
+inode_evict (struct inode *inode) {
+	ASSERT (inode->open_cnt == 0);
+
+	hash_delete (&inode_table, &inode->elem);
+	list_remove (&inode->lru_elem);
+	closed_cnt--;
+	free (inode->extents);
+	free (inode);
+}
 
 /* inode 모듈을 초기화 */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	if (!hash_init (&inode_table, inode_hash, inode_less, NULL))
+		PANIC ("inode table creation failed");
+	list_init (&closed_inodes);
+	lock_init (&inode_table_lock);
 }
 
 /* LENGTH 바이트의 데이터로 inode를 초기화하고
@@ -64,32 +498,52 @@ inode_init (void) {
 bool
 inode_create (disk_sector_t sector, off_t length) {
 	struct inode_disk *disk_inode = NULL;
-	bool success = false;
+	struct inode *inode;
+	bool success;
 
 	ASSERT (length >= 0);
 
 	/* 이 어서션이 실패하면 inode 구조체가 정확히
 	 * 한 섹터 크기가 아니므로 수정해야 함 */
 	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
+	ASSERT (sizeof (struct extent_block) == DISK_SECTOR_SIZE);
 
+	/* 작은 파일은 내용을 inode 안에 담고, 그렇지 않으면 빈 inode를 쓴
+	 * 다음 열어서 LENGTH만큼 늘림 */
 	disk_inode = calloc (1, sizeof *disk_inode);
-	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
+	if (disk_inode == NULL)
+		return false;
+
+	/* 해제되었다가 다시 쓰이는 섹터라면 남아 있는 옛 inode를 버림 */
+	lock_acquire (&inode_table_lock);
+	inode = inode_lookup (sector);
+	if (inode != NULL) {
+		ASSERT (inode->open_cnt == 0);
+		inode_evict (inode);
+	}
+	lock_release (&inode_table_lock);
+
+	disk_inode->magic = INODE_MAGIC;
+	if ((size_t) length <= INLINE_MAX) {
 		disk_inode->length = length;
-		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
-			success = true; 
-		} 
-		free (disk_inode);
+		disk_inode->flags = INODE_INLINE;
+	}
+	page_cache_write (sector, disk_inode);
+	free (disk_inode);
+	if ((size_t) length <= INLINE_MAX)
+		return true;
+
+	inode = inode_open (sector);
+	if (inode == NULL)
+		return false;
+	lock_acquire (&inode->lock);
+	success = inode_grow (inode, length);
+	if (success) {
+		inode->data.length = length;
+		page_cache_write (inode->sector, &inode->data);
 	}
+	lock_release (&inode->lock);
+	inode_close (inode);
 	return success;
 }
 
@@ -98,39 +552,51 @@ inode_create (disk_sector_t sector, off_t length) {
  * 메모리 할당이 실패하면 null 포인터를 반환 */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
 	struct inode *inode;
 
-	/* 이 inode가 이미 열려있는지 확인 */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
+	/* 이 inode가 이미 메모리에 있는지 확인 */
+	lock_acquire (&inode_table_lock);
+	inode = inode_lookup (sector);
+	if (inode != NULL) {
+		if (inode->open_cnt++ == 0) {
+			list_remove (&inode->lru_elem);
+			closed_cnt--;
 		}
+		lock_release (&inode_table_lock);
+		return inode;
 	}
 
 	/* 메모리 할당 */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&inode_table_lock);
 		return NULL;
+	}
 
 	/* 초기화 */
-	list_push_front (&open_inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_init (&inode->lock);
+	page_cache_read (inode->sector, &inode->data);
+	if (!inode_load_extents (inode)) {
+		free (inode);
+		inode = NULL;
+	} else
+		hash_insert (&inode_table, &inode->elem);
+	lock_release (&inode_table_lock);
 	return inode;
 }
 
 /* INODE를 다시 열고 반환 */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&inode_table_lock);
 		inode->open_cnt++;
+		lock_release (&inode_table_lock);
+	}
 	return inode;
 }
 
@@ -141,28 +607,75 @@ inode_get_inumber (const struct inode *inode) {
 }
 
 /* INODE를 닫고 디스크에 씀
- * 이것이 INODE에 대한 마지막 참조였다면 메모리를 해제
- * INODE가 제거된 inode이기도 하다면 블록들을 해제 */
+ * 이것이 INODE에 대한 마지막 참조였다면 다시 열 때를 위해 메모리에
+ * 남겨 둠. INODE가 제거된 inode이기도 하다면 메모리와 블록들을 해제 */
 void
 inode_close (struct inode *inode) {
+	disk_sector_t sector;
+	struct extent_block blk;
+
 	/* null 포인터 무시 */
 	if (inode == NULL)
 		return;
 
-	/* 이것이 마지막 opener였다면 리소스 해제 */
-	if (--inode->open_cnt == 0) {
-		/* inode 리스트에서 제거하고 락 해제 */
-		list_remove (&inode->elem);
+	lock_acquire (&inode_table_lock);
+	if (--inode->open_cnt > 0) {
+		lock_release (&inode_table_lock);
+		return;
+	}
 
-		/* 제거되었다면 블록들 할당 해제 */
-		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
-		}
+	/* 마지막 opener였음. 제거되지 않았다면 LRU 리스트에 넣어 두고,
+	 * 넘치면 가장 오래전에 닫힌 inode를 해제 */
+	if (!inode->removed) {
+		list_push_front (&closed_inodes, &inode->lru_elem);
+		if (++closed_cnt > INODE_CACHE_MAX)
+			inode_evict (list_entry (list_back (&closed_inodes),
+						struct inode, lru_elem));
+		lock_release (&inode_table_lock);
+		return;
+	}
+
+	/* 제거되었다면 inode 테이블에서 빼고 블록들 할당 해제 */
+	hash_delete (&inode_table, &inode->elem);
+	lock_release (&inode_table_lock);
 
-		free (inode); 
+	inode_release_from (inode, 0);
+	sector = inode->data.overflow;
+	while (sector != 0) {
+		page_cache_read (sector, &blk);
+		inode_free_sector (sector);
+		sector = blk.next;
 	}
+	inode_free_sector (inode->sector);
+
+	/* 딸린 디렉터리 인덱스도 함께 제거 */
+	if (inode->data.index != 0) {
+		struct inode *index = inode_open (inode->data.index);
+
+		if (index != NULL) {
+			inode_remove (index);
+			inode_close (index);
+		}
+	}
+
+	free (inode->extents);
+	free (inode); 
+}
+
+/* 디렉터리 INODE의 인덱스 inode 섹터를 반환, 없으면 0 */
+disk_sector_t
+inode_get_index (const struct inode *inode) {
+	return inode->data.index;
+}
+
+/* 디렉터리 INODE의 인덱스 inode 섹터를 INDEX로 설정하고 디스크에 씀
+ * 이 inode가 제거될 때 INDEX도 함께 제거됨 */
+void
+inode_set_index (struct inode *inode, disk_sector_t index) {
+	lock_acquire (&inode->lock);
+	inode->data.index = index;
+	page_cache_write (inode->sector, &inode->data);
+	lock_release (&inode->lock);
 }
 
 /* INODE를 마지막으로 열고 있는 호출자가 닫을 때
@@ -173,18 +686,64 @@ inode_remove (struct inode *inode) {
 	inode->removed = true;
 }
 
+/* INODE의 OFFSET부터 SIZE 바이트를 담은 섹터들을 페이지 캐시로 미리
+ * 읽어 오도록 요청하고, 기다리지 않고 반환 */
+void
+inode_readahead (struct inode *inode, off_t offset, off_t size) {
+	off_t pos = offset - offset % DISK_SECTOR_SIZE;
+	off_t end = offset + size;
+
+	lock_acquire (&inode->lock);
+	if (inode_is_inline (inode))
+		end = pos;
+	if (end > inode_length (inode))
+		end = inode_length (inode);
+	for (; pos < end; pos += DISK_SECTOR_SIZE)
+		page_cache_readahead (byte_to_sector (inode, pos));
+	lock_release (&inode->lock);
+}
+
 /* INODE에서 SIZE 바이트를 BUFFER로 읽어옴, OFFSET 위치에서 시작
  * 실제로 읽은 바이트 수를 반환하며, 오류가 발생하거나
  * 파일 끝에 도달하면 SIZE보다 적을 수 있음 */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
-	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
+	off_t bytes_read = 0;
+
+	/* 사용자 버퍼는 bounce 버퍼를 거쳐 잠금 밖에서 복사 */
+	if (is_user_vaddr (buffer)) {
+		bounce = malloc (DISK_SECTOR_SIZE);
+		if (bounce == NULL)
+			return 0;
+	}
+
+	/* 인라인 파일은 메모리의 inode에서 복사. 사용자 버퍼로는 inode
+	 * 잠금을 놓은 뒤에 옮김 */
+	if (inode_is_inline (inode)) {
+		lock_acquire (&inode->lock);
+		if (inode_is_inline (inode)) {
+			if (offset < inode->data.length) {
+				bytes_read = inode->data.length - offset;
+				if (bytes_read > size)
+					bytes_read = size;
+				memcpy (bounce != NULL ? bounce : buffer,
+						inode->data.inline_data + offset, bytes_read);
+			}
+			lock_release (&inode->lock);
+			if (bounce != NULL) {
+				memcpy (buffer, bounce, bytes_read);
+				free (bounce);
+			}
+			return bytes_read;
+		}
+		lock_release (&inode->lock);
+	}
 
 	while (size > 0) {
 		/* 읽을 디스크 섹터, 섹터 내의 시작 바이트 오프셋 */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		disk_sector_t sector_idx;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* inode에 남은 바이트, 섹터에 남은 바이트, 둘 중 작은 값 */
@@ -197,20 +756,19 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* 전체 섹터를 호출자의 버퍼로 직접 읽기 */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* 섹터를 bounce 버퍼로 읽은 다음 부분적으로
-			 * 호출자의 버퍼로 복사 */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		lock_acquire (&inode->lock);
+		sector_idx = byte_to_sector (inode, offset);
+		lock_release (&inode->lock);
+
+		/* 페이지 캐시에서 호출자의 버퍼로 복사. 사용자 버퍼에서 폴트가
+		 * 나면 폴트 처리가 같은 파일을 읽으며 CACHE_LOCK을 다시 잡을 수
+		 * 있으므로, 캐시 잠금은 bounce 버퍼로 복사하는 동안만 쥠 */
+		if (bounce != NULL) {
+			page_cache_read_at (sector_idx, bounce, sector_ofs, chunk_size);
+			memcpy (buffer + bytes_read, bounce, chunk_size);
+		} else
+			page_cache_read_at (sector_idx, buffer + bytes_read, sector_ofs,
+					chunk_size);
 
 		/* 전진 */
 		size -= chunk_size;
@@ -223,27 +781,66 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 }
 
 /* BUFFER에서 SIZE 바이트를 INODE에 씀, OFFSET에서 시작
- * 실제로 쓴 바이트 수를 반환하며, 파일 끝에 도달하거나
- * 오류가 발생하면 SIZE보다 적을 수 있음
- * (일반적으로 파일 끝에서의 쓰기는 inode를 확장하지만,
- * 확장은 아직 구현되지 않음) */
+ * 실제로 쓴 바이트 수를 반환하며, 쓰기가 거부되었거나
+ * 디스크가 가득 차면 0을 반환
+ * 파일 끝을 넘어 쓰면 inode를 그만큼 확장하며, 그 사이의 빈 곳은
+ * 0으로 채워짐 */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
-	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
+	off_t bytes_written = 0;
+	off_t end = offset + size;
+
+	if (inode->deny_write_cnt || size <= 0)
+		return 0;
 
-	if (inode->deny_write_cnt)
+	/* 사용자 버퍼는 bounce 버퍼를 거쳐 잠금 밖에서 복사. 인라인에 들어갈
+	 * 쓰기는 inode 잠금을 잡기 전에 미리 옮겨 둠 */
+	if (is_user_vaddr (buffer)) {
+		bounce = malloc (DISK_SECTOR_SIZE);
+		if (bounce == NULL)
+			return 0;
+		if ((size_t) end <= INLINE_MAX)
+			memcpy (bounce, buffer, size);
+	}
+
+	/* 데이터를 모두 쓴 다음에 길이를 늘려서, 다른 스레드가 쓰기 전의
+	 * 내용을 읽지 않게 함 */
+	lock_acquire (&inode->lock);
+	if (inode_is_inline (inode)) {
+		/* 인라인에 들어가면 inode 섹터만 고쳐 씀 */
+		if ((size_t) end <= INLINE_MAX) {
+			memcpy (inode->data.inline_data + offset,
+					bounce != NULL ? bounce : buffer, size);
+			if (end > inode->data.length)
+				inode->data.length = end;
+			page_cache_write (inode->sector, &inode->data);
+			lock_release (&inode->lock);
+			free (bounce);
+			return size;
+		}
+		if (!inode_promote (inode)) {
+			lock_release (&inode->lock);
+			free (bounce);
+			return 0;
+		}
+	}
+	if (!inode_grow (inode, end)) {
+		lock_release (&inode->lock);
+		free (bounce);
 		return 0;
+	}
+	lock_release (&inode->lock);
 
 	while (size > 0) {
 		/* 쓸 섹터, 섹터 내의 시작 바이트 오프셋 */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		disk_sector_t sector_idx;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
-		/* inode에 남은 바이트, 섹터에 남은 바이트, 둘 중 작은 값 */
-		off_t inode_left = inode_length (inode) - offset;
+		/* 쓸 범위에 남은 바이트, 섹터에 남은 바이트, 둘 중 작은 값 */
+		off_t inode_left = end - offset;
 		int sector_left = DISK_SECTOR_SIZE - sector_ofs;
 		int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -252,27 +849,20 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* 전체 섹터를 디스크에 직접 쓰기 */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* bounce 버퍼가 필요 */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
+		/* 사용자 버퍼에서 폴트가 나도 inode 잠금이나 캐시 잠금을 쥐고
+		 * 있지 않도록 먼저 bounce 버퍼로 복사 */
+		if (bounce != NULL)
+			memcpy (bounce, buffer + bytes_written, chunk_size);
 
-			/* 섹터에 우리가 쓰고 있는 청크 전후에 데이터가 있다면
-			   먼저 섹터를 읽어야 함. 그렇지 않으면 모든 0으로 된
-			   섹터로 시작 */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		lock_acquire (&inode->lock);
+		sector_idx = lsec_to_sector (inode, offset / DISK_SECTOR_SIZE);
+		lock_release (&inode->lock);
+
+		/* 페이지 캐시에 쓰기. 섹터 일부만 쓰면 캐시가 나머지를
+		 * 디스크에서 먼저 읽어 옴 */
+		page_cache_write_at (sector_idx,
+				bounce != NULL ? bounce : buffer + bytes_written, sector_ofs,
+				chunk_size);
 
 		/* 전진 */
 		size -= chunk_size;
@@ -281,6 +871,13 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	}
 	free (bounce);
 
+	lock_acquire (&inode->lock);
+	if (end > inode->data.length) {
+		inode->data.length = end;
+		page_cache_write (inode->sector, &inode->data);
+	}
+	lock_release (&inode->lock);
+
 	return bytes_written;
 }
 
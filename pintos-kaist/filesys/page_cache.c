@@ -1,50 +1,339 @@
-/* page_cache.c: 페이지 캐시(버퍼 캐시) 구현 */
-
-#include "vm/vm.h"
-static bool page_cache_readahead (struct page *page, void *kva);
-static bool page_cache_writeback (struct page *page);
-static void page_cache_destroy (struct page *page);
-
-/* 이 구조체를 수정하지 마세요 */
-static const struct page_operations page_cache_op = {
-	.swap_in = page_cache_readahead,
-	.swap_out = page_cache_writeback,
-	.destroy = page_cache_destroy,
-	.type = VM_PAGE_CACHE,
+/* page_cache.c: 페이지 캐시(버퍼 캐시) 구현
+ *
+ * 파일 시스템 디스크의 섹터를 고정된 개수의 슬롯에 담아 둡니다. 슬롯은
+ * 섹터 번호로 해시에 색인되고, 자리가 모자라면 시계 알고리즘으로 희생
+ * 슬롯을 고릅니다. 쓰기는 슬롯에만 반영하고 더티로 표시해 두었다가,
+ * 희생될 때나 주기적으로 깨어나는 플러시 스레드, 그리고 filesys_done()
+ * 때 디스크에 씁니다. 순차 읽기가 앞으로 필요할 섹터는 미리 읽기 큐에
+ * 넣어 두면 미리 읽기 스레드가 비동기로 채웁니다.
+ *
+ * CACHE_LOCK은 슬롯의 상태와 내용, 해시를 보호합니다. 디스크 입출력은
+ * 락을 놓고 하며, 그동안 슬롯은 BUSY로 표시됩니다. BUSY 슬롯을 쓰려는
+ * 스레드는 IO_DONE을 기다린 뒤 처음부터 다시 찾습니다. */
+
+#include "filesys/page_cache.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* 캐시 슬롯 수 (섹터) */
+#define CACHE_SLOTS 64
+
+/* 플러시 스레드가 더티 슬롯을 쓰는 주기 (밀리초) */
+#define FLUSH_INTERVAL_MS 1000
+
+/* 미리 읽기 큐의 크기 (섹터). 가득 차면 요청을 버립니다. */
+#define RA_QUEUE_SIZE 64
+
+/* 섹터 하나를 담는 캐시 슬롯 */
+struct cache_slot {
+	disk_sector_t sector;       /* 담고 있는 섹터 */
+	uint8_t *data;              /* DISK_SECTOR_SIZE 바이트의 내용 */
+	bool valid;                 /* SECTOR의 내용을 담고 있음 */
+	bool dirty;                 /* 디스크에 쓰지 않은 변경이 있음 */
+	bool accessed;              /* 시계 알고리즘의 참조 비트 */
+	bool busy;                  /* 디스크 입출력 중 */
+	struct hash_elem elem;      /* 섹터 해시의 요소 */
 };
 
+static struct cache_slot slots[CACHE_SLOTS];
+static struct hash cache_map;       /* 섹터 -> VALID 또는 BUSY 슬롯 */
+static size_t clock_hand;
+static struct lock cache_lock;
+static struct condition io_done;    /* BUSY 슬롯의 입출력이 끝남 */
+static bool cache_ready;
+
+/* 미리 읽기 큐. CACHE_LOCK이 보호합니다. */
+static disk_sector_t ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head;              /* 다음에 꺼낼 요청 */
+static size_t ra_cnt;               /* 큐에 든 요청 수 */
+static struct condition ra_ready;   /* 큐에 요청이 들어옴 */
+
+/* 통계 */
+static long long hit_cnt;           /* 캐시에서 바로 처리한 접근 */
+static long long miss_cnt;          /* 슬롯을 새로 채운 접근 */
+static long long writeback_cnt;     /* 디스크에 쓴 더티 슬롯 */
+static long long readahead_cnt;     /* 미리 읽은 섹터 */
+
+static void page_cache_kworkerd (void *aux);
+static void page_cache_readaheadd (void *aux);
+
 tid_t page_cache_workerd;
+tid_t page_cache_readerd;
+
+static uint64_t
+slot_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct cache_slot *s = hash_entry (e, struct cache_slot, elem);
+	return hash_int (s->sector);
+}
+
+static bool
+slot_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct cache_slot, elem)->sector
+		< hash_entry (b, struct cache_slot, elem)->sector;
+}
 
-/* 파일 vm의 초기화 함수 */
+/* 페이지 캐시를 초기화하고 플러시 스레드를 시작합니다.
+ * filesys_disk를 연 뒤, 파일 시스템이 처음 디스크에 접근하기 전에
+ * 호출해야 합니다. */
 void
-pagecache_init (void) {
-	/* TODO: page_cache_kworkerd를 사용하여 페이지 캐시용 워커 데몬을 생성하세요 */
+page_cache_init (void) {
+	size_t per_page = PGSIZE / DISK_SECTOR_SIZE;
+	size_t i;
+
+	lock_init (&cache_lock);
+	cond_init (&io_done);
+	cond_init (&ra_ready);
+	if (!hash_init (&cache_map, slot_hash, slot_less, NULL))
+		PANIC ("page cache hash creation failed");
+
+	for (i = 0; i < CACHE_SLOTS; i++) {
+		if (i % per_page == 0)
+			slots[i].data = palloc_get_page (PAL_ASSERT);
+		else
+			slots[i].data = slots[i - 1].data + DISK_SECTOR_SIZE;
+		slots[i].valid = slots[i].dirty = false;
+		slots[i].accessed = slots[i].busy = false;
+	}
+	cache_ready = true;
+
+	page_cache_workerd = thread_create ("kflushd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	page_cache_readerd = thread_create ("kreadahead", PRI_DEFAULT,
+			page_cache_readaheadd, NULL);
 }
 
-/* 페이지 캐시 초기화 */
-bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
-	/* 핸들러 설정 */
-	page->operations = &page_cache_op;
+/* SECTOR를 담은 슬롯을 찾습니다. 없으면 NULL을 반환합니다.
+ * BUSY 슬롯도 반환합니다. */
+static struct cache_slot *
+slot_lookup (disk_sector_t sector) {
+	struct cache_slot key;
+	struct hash_elem *e;
 
+	key.sector = sector;
+	e = hash_find (&cache_map, &key.elem);
+	return e != NULL ? hash_entry (e, struct cache_slot, elem) : NULL;
 }
 
-/* 스왑 인 메커니즘을 활용하여 미리 읽기 구현 */
-static bool
-page_cache_readahead (struct page *page, void *kva) {
+/* 더티 슬롯 S를 디스크에 씁니다. CACHE_LOCK을 쥔 채로 호출하며, 쓰는
+ * 동안에는 락을 놓습니다. */
+static void
+page_cache_writeback (struct cache_slot *s) {
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+	ASSERT (s->valid && s->dirty && !s->busy);
+
+	s->busy = true;
+	s->dirty = false;
+	lock_release (&cache_lock);
+	disk_write (filesys_disk, s->sector, s->data);
+	lock_acquire (&cache_lock);
+	s->busy = false;
+	writeback_cnt++;
+	cond_broadcast (&io_done, &cache_lock);
 }
 
-/* 스왑 아웃 메커니즘을 활용하여 쓰기 후 저장 구현 */
-static bool
-page_cache_writeback (struct page *page) {
+/* 시계 알고리즘으로 희생 슬롯을 고릅니다. 최근에 접근한 슬롯은 한 번
+ * 건너뛰고, BUSY 슬롯은 고르지 않습니다. 모든 슬롯이 BUSY이면 NULL을
+ * 반환합니다. */
+static struct cache_slot *
+slot_get_victim (void) {
+	size_t i;
+
+	for (i = 0; i < 2 * CACHE_SLOTS; i++) {
+		struct cache_slot *s = &slots[clock_hand];
+
+		clock_hand = (clock_hand + 1) % CACHE_SLOTS;
+		if (s->busy)
+			continue;
+		if (!s->valid)
+			return s;
+		if (s->accessed)
+			s->accessed = false;
+		else
+			return s;
+	}
+	return NULL;
 }
 
-/* page_cache를 파괴합니다 */
+/* SECTOR를 담은 슬롯을 반환합니다. CACHE_LOCK을 쥔 채로 호출합니다.
+ * 캐시에 없으면 희생 슬롯을 비워 채우는데, 호출자가 섹터 전체를 덮어쓸
+ * 것이라면 (FILL이 false) 디스크에서 읽지 않습니다. 반환된 슬롯은 BUSY가
+ * 아니며, 호출자가 락을 쥐고 있는 동안 유효합니다. */
+static struct cache_slot *
+slot_get (disk_sector_t sector, bool fill) {
+	struct cache_slot *s;
+
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+
+	for (;;) {
+		s = slot_lookup (sector);
+		if (s != NULL) {
+			if (s->busy) {
+				cond_wait (&io_done, &cache_lock);
+				continue;
+			}
+			hit_cnt++;
+			s->accessed = true;
+			return s;
+		}
+
+		s = slot_get_victim ();
+		if (s == NULL) {
+			cond_wait (&io_done, &cache_lock);
+			continue;
+		}
+		if (s->valid && s->dirty) {
+			/* 쓰는 동안 상황이 바뀔 수 있으므로 다시 찾습니다. */
+			page_cache_writeback (s);
+			continue;
+		}
+		break;
+	}
+
+	/* S를 SECTOR에 다시 씁니다. */
+	if (s->valid)
+		hash_delete (&cache_map, &s->elem);
+	s->sector = sector;
+	s->valid = true;
+	s->accessed = true;
+	hash_insert (&cache_map, &s->elem);
+	miss_cnt++;
+
+	if (fill) {
+		s->busy = true;
+		lock_release (&cache_lock);
+		disk_read (filesys_disk, sector, s->data);
+		lock_acquire (&cache_lock);
+		s->busy = false;
+		cond_broadcast (&io_done, &cache_lock);
+	}
+	return s;
+}
+
+/* SECTOR의 OFS 바이트부터 SIZE 바이트를 BUFFER로 읽습니다. CACHE_LOCK을
+ * 쥔 채 복사하므로 BUFFER는 페이지 폴트가 나지 않는 커널 메모리여야
+ * 합니다. */
+void
+page_cache_read_at (disk_sector_t sector, void *buffer, int ofs, int size) {
+	struct cache_slot *s;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	s = slot_get (sector, true);
+	memcpy (buffer, s->data + ofs, size);
+	lock_release (&cache_lock);
+}
+
+/* BUFFER의 SIZE 바이트를 SECTOR의 OFS 바이트 위치에 씁니다. 캐시에만
+ * 반영되며 디스크에는 나중에 쓰입니다. BUFFER는 page_cache_read_at()과
+ * 같이 커널 메모리여야 합니다. */
+void
+page_cache_write_at (disk_sector_t sector, const void *buffer, int ofs,
+		int size) {
+	struct cache_slot *s;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	s = slot_get (sector, size < DISK_SECTOR_SIZE);
+	memcpy (s->data + ofs, buffer, size);
+	s->dirty = true;
+	lock_release (&cache_lock);
+}
+
+/* SECTOR 전체를 BUFFER로 읽습니다. */
+void
+page_cache_read (disk_sector_t sector, void *buffer) {
+	page_cache_read_at (sector, buffer, 0, DISK_SECTOR_SIZE);
+}
+
+/* BUFFER를 SECTOR 전체에 씁니다. */
+void
+page_cache_write (disk_sector_t sector, const void *buffer) {
+	page_cache_write_at (sector, buffer, 0, DISK_SECTOR_SIZE);
+}
+
+/* SECTOR를 캐시로 미리 읽어 오도록 요청하고 바로 반환합니다.
+ * 이미 캐시에 있거나 큐가 가득 차면 아무것도 하지 않습니다. */
+void
+page_cache_readahead (disk_sector_t sector) {
+	lock_acquire (&cache_lock);
+	if (slot_lookup (sector) == NULL && ra_cnt < RA_QUEUE_SIZE) {
+		ra_queue[(ra_head + ra_cnt++) % RA_QUEUE_SIZE] = sector;
+		cond_signal (&ra_ready, &cache_lock);
+	}
+	lock_release (&cache_lock);
+}
+
+/* 모든 더티 슬롯을 디스크에 씁니다. */
+void
+page_cache_flush (void) {
+	size_t i;
+
+	if (!cache_ready)
+		return;
+
+	lock_acquire (&cache_lock);
+	for (i = 0; i < CACHE_SLOTS; i++) {
+		struct cache_slot *s = &slots[i];
+
+		while (s->busy)
+			cond_wait (&io_done, &cache_lock);
+		if (s->valid && s->dirty)
+			page_cache_writeback (s);
+	}
+	lock_release (&cache_lock);
+}
+
+/* 페이지 캐시 통계를 출력합니다. */
+void
+page_cache_print_stats (void) {
+	printf ("Page cache: %lld hits, %lld misses, %lld write-backs, "
+			"%lld read-ahead\n",
+			hit_cnt, miss_cnt, writeback_cnt, readahead_cnt);
+}
+
+/* 페이지 캐시용 워커 스레드.
+ * 주기적으로 깨어나 더티 슬롯을 디스크에 써서, 전원이 갑자기 꺼져도
+ * 잃는 변경이 FLUSH_INTERVAL_MS 이내가 되게 합니다. */
 static void
-page_cache_destroy (struct page *page) {
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		timer_msleep (FLUSH_INTERVAL_MS);
+		page_cache_flush ();
+	}
 }
 
-/* 페이지 캐시용 워커 스레드 */
+/* 미리 읽기 스레드.
+ * 큐에서 섹터를 꺼내 캐시에 채웁니다. 미리 읽은 슬롯은 참조 비트를
+ * 꺼 두어, 실제로 읽히기 전에는 시계 알고리즘에서 먼저 희생되게
+ * 합니다. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_readaheadd (void *aux UNUSED) {
+	lock_acquire (&cache_lock);
+	for (;;) {
+		disk_sector_t sector;
+
+		while (ra_cnt == 0)
+			cond_wait (&ra_ready, &cache_lock);
+		sector = ra_queue[ra_head];
+		ra_head = (ra_head + 1) % RA_QUEUE_SIZE;
+		ra_cnt--;
+
+		if (slot_lookup (sector) == NULL) {
+			struct cache_slot *s = slot_get (sector, true);
+
+			s->accessed = false;
+			readahead_cnt++;
+		}
+	}
 }
@@ -6,7 +6,13 @@
 
 /* 시스템 파일 아이노드의 섹터들. */
 #define FREE_MAP_SECTOR 0       /* 프리 맵 파일 아이노드 섹터. */
+#ifdef EFILESYS
+#include "filesys/fat.h"
+/* FAT 파일시스템에서는 루트 디렉터리 클러스터의 섹터. */
+#define ROOT_DIR_SECTOR (cluster_to_sector (ROOT_DIR_CLUSTER))
+#else
 #define ROOT_DIR_SECTOR 1       /* 루트 디렉터리 파일 아이노드 섹터. */
+#endif
 
 /* 파일 시스템에 사용되는 디스크. */
 extern struct disk *filesys_disk;
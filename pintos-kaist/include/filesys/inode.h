@@ -8,13 +8,18 @@
 struct bitmap;
 
 void inode_init (void);
+bool inode_alloc_sector (disk_sector_t *);
+void inode_free_sector (disk_sector_t);
 bool inode_create (disk_sector_t, off_t);
 struct inode *inode_open (disk_sector_t);
 struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
+disk_sector_t inode_get_index (const struct inode *);
+void inode_set_index (struct inode *, disk_sector_t);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
+void inode_readahead (struct inode *, off_t offset, off_t size);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
@@ -1,12 +1,19 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
-
-struct page;
-enum vm_type;
+#include "devices/disk.h"
 
+/* 페이지 캐시는 VM 페이지가 아니라 섹터 단위로 관리하므로, struct page의
+ * 유니온에 둘 상태는 없습니다. */
 struct page_cache {};
 
 void page_cache_init (void);
-bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+void page_cache_read (disk_sector_t sector, void *buffer);
+void page_cache_write (disk_sector_t sector, const void *buffer);
+void page_cache_read_at (disk_sector_t sector, void *buffer, int ofs,
+		int size);
+void page_cache_write_at (disk_sector_t sector, const void *buffer, int ofs,
+		int size);
+void page_cache_readahead (disk_sector_t sector);
+void page_cache_flush (void);
+void page_cache_print_stats (void);
 #endif
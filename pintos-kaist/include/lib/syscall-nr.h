@@ -1,6 +1,8 @@
 #ifndef __LIB_SYSCALL_NR_H
 #define __LIB_SYSCALL_NR_H
 
+#include <stddef.h>
+
 /* 시스템 콜 번호들 */
 enum {
 	/* 프로젝트 2 이후 */
@@ -36,6 +38,67 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* 가상 메모리 확장 */
+	SYS_MADVISE,                /* 매핑의 접근 방식 알림 */
+	SYS_MSYNC,                  /* 파일 매핑의 변경 내용을 파일에 씀 */
+	SYS_SHM_OPEN,               /* 공유 메모리 세그먼트 생성 또는 찾기 */
+	SYS_SHM_MAP,                /* 공유 메모리 세그먼트 매핑 */
+	SYS_SHM_UNMAP,              /* 공유 메모리 매핑 제거 */
+	SYS_SETRLIMIT,              /* 자원 사용 상한 설정 */
+	SYS_MEMSTAT,                /* 메모리 사용량 조회 */
+	SYS_FAULTSTAT,              /* 페이지 폴트 통계 조회 */
+
+	/* 프로세스 간 통신 */
+	SYS_PIPE,                   /* 파이프 생성 */
+};
+
+/* mmap_flags()의 FLAGS 인자 */
+#define MAP_POPULATE 0x1            /* 매핑하면서 모든 페이지를 미리 읽음 */
+
+/* madvise()의 ADVICE 인자 */
+enum {
+	MADV_NORMAL,                /* 기본 동작 */
+	MADV_RANDOM,                /* 임의 접근: 폴트 어라운드를 하지 않음 */
+	MADV_SEQUENTIAL,            /* 순차 접근: 크게 미리 읽고 지나간 페이지를 버림 */
+	MADV_WILLNEED,              /* 곧 쓸 구간을 미리 읽음 */
+	MADV_DONTNEED,              /* 구간의 페이지를 버리고 프레임을 돌려줌 */
+};
+
+/* setrlimit()의 RESOURCE 인자 */
+enum {
+	RLIMIT_RSS,                 /* 프레임에 올라와 있는 페이지 수 */
+};
+
+/* 상한 없음 */
+#define RLIM_INFINITY ((size_t) -1)
+
+/* memstat()이 채우는 프로세스의 메모리 사용량 (페이지) */
+struct memstat {
+	size_t rss;                 /* 프레임에 올라와 있는 페이지 수 */
+	size_t swap;                /* 스왑에 나가 있는 페이지 수 */
+	size_t rss_limit;           /* RLIMIT_RSS 상한, 없으면 RLIM_INFINITY */
+};
+
+/* 페이지 폴트의 종류 */
+enum {
+	FAULT_STACK,                /* 스택 확장 */
+	FAULT_ELF,                  /* 실행 파일 세그먼트의 지연 로딩 */
+	FAULT_MMAP,                 /* 파일 매핑 */
+	FAULT_ZERO,                 /* 0으로 채우는 익명 페이지 */
+	FAULT_SWAP,                 /* 축출된 익명 페이지의 스왑 인 */
+	FAULT_COW,                  /* 쓰기 시 복사 */
+	FAULT_INVALID,              /* 처리할 수 없어 프로세스를 죽인 폴트 */
+	FAULT_TYPE_CNT
+};
+
+/* faultstat()이 채우는 폴트 종류별 통계 */
+struct faultstat {
+	struct {
+		long long cnt;          /* 폴트 수 */
+		long long cycles;       /* 처리에 걸린 TSC 사이클의 합 */
+		long long sectors;      /* 처리하며 읽고 쓴 디스크 섹터 수 */
+	} type[FAULT_TYPE_CNT];
 };
 
 #endif /* lib/syscall-nr.h */
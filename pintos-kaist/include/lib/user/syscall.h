@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <syscall-nr.h>
 
 /* 프로세스 식별자 */
 typedef int pid_t;
@@ -37,10 +38,21 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int pipe (int fds[2]);
 
 /* 프로젝트 3 그리고 선택적으로 프로젝트 4 */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void *mmap_flags (void *addr, size_t length, int writable, int fd,
+		off_t offset, int flags);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+int shm_open (const char *name, size_t size);
+void *shm_map (int id, void *addr);
+int shm_unmap (void *addr);
+int setrlimit (int resource, size_t limit);
+int memstat (struct memstat *st);
+int faultstat (struct faultstat *st);
 
 /* 프로젝트 4만 */
 bool chdir (const char *dir);
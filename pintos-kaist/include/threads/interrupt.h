@@ -38,17 +38,27 @@ struct intr_frame {
 	/* intr-stubs.S의 intr_entry에 의해 스택에 푸시됨.
 	   인터럽트가 발생한 작업의 저장된 레지스터들 */
 	struct gp_registers R;        /* 범용 레지스터들 (rax, rbx, rcx, rdx, rsi, rdi, rbp, r8-r15) */
+	uint16_t es;                  /* 엑스트라 세그먼트 */
+	uint16_t __pad1;              /* 패딩 */
+	uint32_t __pad2;              /* 패딩 */
+	uint16_t ds;                  /* 데이터 세그먼트 */
+	uint16_t __pad3;              /* 패딩 */
+	uint32_t __pad4;              /* 패딩 */
+	/* intr-stubs.S의 intrNN_stub에 의해 푸시됨 */
 	uint64_t vec_no;              /* 인터럽트 벡터 번호 */
+	/* CPU가 푸시하거나, CPU가 푸시하지 않는 경우 intrNN_stub이 0을 푸시 */
 	uint64_t error_code;          /* 에러 코드 */
-	void (*eip) (void);           /* 인터럽트된 코드 주소 */
+	/* CPU에 의해 푸시됨
+	   인터럽트된 작업의 저장된 레지스터들 */
+	uintptr_t rip;                /* 인터럽트된 코드 주소 */
 	uint16_t cs;                  /* 코드 세그먼트 */
-	uint16_t pad1;                /* 패딩 */
-	uint32_t pad2;                /* 패딩 */
+	uint16_t __pad5;              /* 패딩 */
+	uint32_t __pad6;              /* 패딩 */
 	uint64_t eflags;              /* 저장된 플래그 레지스터 */
-	void *esp;                    /* 인터럽트된 스택 포인터 */
+	uintptr_t rsp;                /* 인터럽트된 스택 포인터 */
 	uint16_t ss;                  /* 스택 세그먼트 */
-	uint16_t pad3;                /* 패딩 */
-	uint32_t pad4;                /* 패딩 */
+	uint16_t __pad7;              /* 패딩 */
+	uint32_t __pad8;              /* 패딩 */
 } __attribute__((packed));
 
 typedef void intr_handler_func (struct intr_frame *);
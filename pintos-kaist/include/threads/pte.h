@@ -41,5 +41,10 @@
 #define PTE_U 0x4                        /* 1=사용자/커널, 0=커널 전용 */
 #define PTE_A 0x20                       /* 1=접근됨, 0=접근되지 않음 */
 #define PTE_D 0x40                       /* 1=더티, 0=더티 아님 (PTE만 해당) */
+#define PTE_PS 0x80                      /* 1=2 MiB 큰 페이지 (PDE만 해당) */
+
+/* 페이지 디렉터리 항목 하나가 직접 매핑하는 큰 페이지 */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)
+#define is_large_pte(pte) ((*(pte) & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
 
 #endif /* threads/pte.h */
@@ -9,6 +9,7 @@
 #include "threads/interrupt.h"
 // #include "./interrupt.h"
 #ifdef VM
+#include <syscall-nr.h>
 #include "vm/vm.h"
 #endif
 
@@ -105,19 +106,28 @@ struct thread {
 
     struct lock *waiting_lock;          /* 내가 기다리고 있는 락 */
 
-    /* project 2 을 위한 구조체 */
-    uint64_t *pml4;
-
         
 
 
+	long long disk_sectors;             /* 이 스레드가 읽고 쓴 디스크 섹터 수 */
+
 #ifdef USERPROG
 	/* userprog/process.c가 소유 */
 	uint64_t *pml4;                     /* 페이지 맵 레벨 4 */
+	struct file *exec_file;             /* 실행 중인 ELF 파일 */
+	int exit_status;                    /* exit()로 넘긴 종료 상태 */
+	struct fd *fd_table;                /* 파일 디스크립터 -> 열린 객체 */
 #endif
 #ifdef VM
 	/* 스레드가 소유한 전체 가상 메모리를 위한 테이블 */
 	struct supplemental_page_table spt;
+	uintptr_t user_rsp;                 /* 시스템 콜 진입 시의 사용자 스택 포인터 */
+
+	/* 메모리 사용량 (페이지) */
+	size_t rss;                         /* 프레임에 매핑된 페이지 수 */
+	size_t swap_cnt;                    /* 스왑에 나가 있는 페이지 수 */
+	size_t rss_limit;                   /* 상주 페이지 상한, 0이면 제한 없음 */
+	struct faultstat faults;            /* 폴트 종류별 횟수, 사이클, 섹터 */
 #endif
 
 	/* thread.c가 소유 */
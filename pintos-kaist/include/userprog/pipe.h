@@ -0,0 +1,14 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pipe;
+
+struct pipe *pipe_create (void);
+void pipe_close (struct pipe *pipe, bool write_end);
+int pipe_read (struct pipe *pipe, void *buffer, size_t size);
+int pipe_write (struct pipe *pipe, const void *buffer, size_t size);
+
+#endif /* userprog/pipe.h */
@@ -3,6 +3,9 @@
 
 #include "threads/thread.h"
 
+struct file;
+struct pipe;
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
@@ -10,4 +13,10 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
 
+int process_add_file (struct file *file);
+int process_add_pipe (struct pipe *pipe, bool write_end);
+struct file *process_get_file (int fd);
+struct pipe *process_get_pipe (int fd, bool write_end);
+void process_close_fd (int fd);
+
 #endif /* userprog/process.h */
@@ -1,13 +1,18 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
 #include "vm/vm.h"
+struct frame;
 struct page;
 enum vm_type;
 
 struct anon_page {
+	size_t slot;                /* 내용이 있는 스왑 슬롯, 없으면 BITMAP_ERROR */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t swap_write (struct frame *frame);
+void swap_read (size_t slot, void *kva);
+void swap_slot_put (size_t slot);
 
 #endif
@@ -4,6 +4,7 @@
 #include "vm/vm.h"
 
 struct page;
+struct vma;
 enum vm_type;
 
 struct file_page {
@@ -14,4 +15,8 @@ bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+int do_madvise (void *addr, size_t length, int advice);
+int do_msync (void *addr, size_t length);
+void file_backed_flush (struct vma *vma, void *start, void *end);
+void vm_file_print_stats (void);
 #endif
@@ -0,0 +1,15 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stddef.h>
+
+struct frame;
+
+/* 한 번 깨어날 때마다 훑을 프레임 수. 0이면 KSM을 끕니다. */
+extern size_t ksm_pages_to_scan;
+
+void ksm_init (void);
+void ksm_frame_freed (struct frame *frame);
+void ksm_unmerge (struct frame *frame);
+void ksm_print_stats (void);
+
+#endif /* VM_KSM_H */
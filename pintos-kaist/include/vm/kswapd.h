@@ -0,0 +1,13 @@
+#ifndef VM_KSWAPD_H
+#define VM_KSWAPD_H
+#include <stddef.h>
+
+/* 남은 프레임이 이보다 적으면 kswapd가 깨어납니다. 높은 워터마크는
+ * 이 값의 두 배입니다. 0이면 kswapd를 끕니다. */
+extern size_t kswapd_low_wmark;
+
+void kswapd_init (void);
+void kswapd_poke (size_t free_frames);
+void kswapd_print_stats (void);
+
+#endif /* VM_KSWAPD_H */
@@ -0,0 +1,17 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct frame;
+struct inode;
+
+void share_init (void);
+struct frame *share_lookup (struct inode *inode, off_t ofs,
+		size_t read_bytes);
+void share_insert (struct frame *frame, struct inode *inode, off_t ofs,
+		size_t read_bytes);
+void share_remove (struct frame *frame);
+void share_print_stats (void);
+
+#endif /* VM_SHARE_H */
@@ -0,0 +1,58 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+struct frame;
+struct page;
+struct supplemental_page_table;
+enum vm_type;
+
+/* 세그먼트 이름의 최대 길이 */
+#define SHM_NAME_MAX 14
+
+/* 세그먼트 페이지 하나의 내용이 있는 곳.
+ * 프레임에 올라와 있으면 FRAME이, 스왑으로 내보내졌으면 SLOT이, 스왑이
+ * 가득 차 커널 페이지에 옮겨 두었으면 KPAGE가 유효하고, 셋 다 없으면
+ * 아직 쓰인 적 없는 0 페이지입니다. */
+struct shm_page {
+	struct frame *frame;        /* 올라와 있는 프레임, 없으면 NULL */
+	size_t slot;                /* 스왑 슬롯, 없으면 BITMAP_ERROR */
+	void *kpage;                /* 내용을 옮겨 둔 커널 페이지, 없으면 NULL */
+};
+
+/* 공유 메모리 세그먼트.
+ * 여러 프로세스가 같은 프레임을 쓰기 가능하게 매핑하는 익명 메모리입니다.
+ * 페이지의 내용은 각 프로세스의 struct page가 아니라 세그먼트가 가지므로
+ * 축출되었다가 어느 프로세스에서 다시 올라와도 모두 같은 내용을 봅니다. */
+struct shm_segment {
+	int id;                     /* shm_open()이 돌려주는 식별자 */
+	char name[SHM_NAME_MAX + 1];
+	size_t page_cnt;            /* 세그먼트 크기 (페이지) */
+	struct shm_page *pages;     /* 페이지별 내용 위치 */
+	int ref_cnt;                /* 매핑한 VMA 수 + 연 프로세스 수 */
+	struct lock lock;           /* 같은 페이지를 두 번 채우지 않도록 함 */
+	struct list_elem elem;      /* 세그먼트 목록 요소 */
+};
+
+/* 프로세스가 shm_open()으로 연 세그먼트 하나.
+ * 프로세스가 끝날 때까지 세그먼트의 참조를 하나 가집니다. */
+struct shm_handle {
+	struct shm_segment *seg;
+	struct list_elem elem;      /* spt의 SHM_OPENS 요소 */
+};
+
+void shm_init (void);
+int do_shm_open (const char *name, size_t size);
+void *do_shm_map (int id, void *addr);
+int do_shm_unmap (void *addr);
+void shm_segment_get (struct shm_segment *seg);
+void shm_segment_put (struct shm_segment *seg);
+void shm_exit (struct supplemental_page_table *spt);
+struct shm_page *shm_lookup (struct page *page);
+bool shm_initializer (struct page *page, enum vm_type type, void *kva);
+void shm_frame_freed (struct frame *frame);
+
+#endif /* VM_SHM_H */
@@ -1,7 +1,10 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 
 enum vm_type {
 	/* 초기화되지 않은 페이지 */
@@ -24,9 +27,19 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+/* 파일에서 지연 로딩되는 페이지. 읽을 위치는 페이지가 속한 VMA가
+ * 알려 줍니다. */
+#define VM_LAZY_FILE VM_MARKER_0
+
+/* 공유 메모리 세그먼트의 페이지. 내용은 세그먼트가 가지며 여러 프로세스가
+ * 같은 프레임을 쓰기 가능하게 함께 매핑합니다. */
+#define VM_SHM VM_MARKER_1
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
+#include "vm/shm.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -46,6 +59,12 @@ struct page {
 	struct frame *frame;   /* 프레임에 대한 역참조 */
 
 	/* Your implementation */
+	struct hash_elem spt_elem;  /* 보조 페이지 테이블의 해시 요소 */
+	bool writable;              /* 사용자 쓰기 허용 여부 */
+	struct vma *vma;            /* 이 페이지를 만든 VMA */
+	struct list_elem vma_elem;  /* VMA의 페이지 목록 요소 */
+	struct thread *owner;       /* 이 페이지를 가진 프로세스 */
+	struct list_elem frame_elem;  /* 프레임의 역매핑 목록 요소 */
 
 	/* 타입별 데이터가 유니온에 바인딩됩니다.
 	 * 각 함수는 현재 유니온을 자동으로 감지합니다 */
@@ -59,12 +78,51 @@ struct page {
 	};
 };
 
-/* "프레임"의 표현 */
+/* "프레임"의 표현.
+ * 사용자 풀의 물리 페이지마다 하나씩 부팅 때 만들어 두며, 폴트 때 따로
+ * 할당하지 않습니다. */
 struct frame {
 	void *kva;
 	struct page *page;
+
+	/* Your implementation */
+	struct list pages;          /* 이 프레임을 매핑한 페이지들 (역매핑) */
+	size_t ref_cnt;             /* PAGES에 들어 있는 페이지 수 */
+
+	/* 축출 상태 */
+	int pin_cnt;                /* 0보다 크면 축출하지 않음 */
+	bool in_use;                /* 내용이 채워져 축출과 KSM의 대상임 */
+	bool evicting;              /* 내용을 내보내는 중 */
+	size_t swap_slot;           /* 축출 중 내용을 쓴 스왑 슬롯 */
+
+	/* 공유 메모리 세그먼트의 페이지이면 그 세그먼트 페이지, 아니면 NULL */
+	struct shm_page *shm;
+
+	/* 공유 페이지 캐시 키. 공유 프레임이 아니면 INODE가 NULL입니다. */
+	struct inode *inode;        /* 내용을 읽어 온 파일의 아이노드 */
+	off_t ofs;                  /* 내용이 시작하는 파일 오프셋 */
+	size_t read_bytes;          /* 파일에서 읽은 바이트, 나머지는 0 */
+	struct hash_elem share_elem;  /* 공유 페이지 캐시 요소 */
+
+	/* KSM 상태 */
+	uint64_t checksum;          /* 마지막으로 훑었을 때 내용의 해시 */
+	struct hash_elem ksm_elem;  /* 안정 또는 불안정 테이블 요소 */
+	bool merged;                /* 합쳐진 읽기 전용 공유 프레임 */
+	bool unstable;              /* 이번 회차의 병합 후보 */
 };
 
+/* 프레임 테이블.
+ * 사용자 풀 전체를 덮는 FRAME_CNT개의 프레임 배열로, 사용자 풀의
+ * (KVA - 풀 시작) / PGSIZE 번째 페이지가 FRAME_TABLE[그 번호]입니다.
+ * IN_USE가 참인 프레임만 사용 중입니다.
+ * FRAME_LOCK은 프레임 상태와, 프레임과 페이지 사이의 연결(page->frame,
+ * frame->pages)과 그에 해당하는 페이지 테이블 항목을 보호합니다. */
+extern struct frame *frame_table;
+extern size_t frame_cnt;
+extern struct lock frame_lock;
+
+struct frame *vm_frame_lookup (void *kva);
+
 /* 페이지 연산을 위한 함수 테이블.
  * 이것은 C에서 "인터페이스"를 구현하는 한 가지 방법입니다.
  * "메서드" 테이블을 구조체의 멤버에 넣고, 필요할 때마다 호출합니다. */
@@ -84,8 +142,19 @@ struct page_operations {
  * 이 구조체에 대한 특정 설계를 강요하지 않습니다.
  * 모든 설계는 여러분에게 달려 있습니다. */
 struct supplemental_page_table {
+	struct vma_tree vmas;       /* 매핑된 구간들 */
+	struct hash pages;          /* 폴트로 만들어진 페이지 -> struct page */
+
+	/* 폴트 어라운드 상태 */
+	void *fa_next;              /* 직전 창 바로 다음 페이지 */
+	size_t fa_window;           /* 현재 창 크기 (페이지) */
+
+	struct list shm_opens;      /* shm_open()으로 연 세그먼트의 핸들 */
 };
 
+/* 폴트 어라운드 창의 최대 페이지 수. 0이나 1이면 사용하지 않습니다. */
+extern size_t fault_around_pages;
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -95,6 +164,8 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_insert_vma (struct supplemental_page_table *spt, struct vma *vma);
+void spt_remove_vma (struct supplemental_page_table *spt, struct vma *vma);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -106,6 +177,22 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+void vm_release_frame (struct page *page);
+bool vm_drop_frame (struct page *page);
+bool vm_frame_link (struct frame *frame, struct page *page, bool writable);
+void vm_frame_unlink (struct page *page);
+bool vm_page_set_writable (struct page *page, bool writable);
+bool vm_pin_frame (struct page *page);
+void vm_unpin_frame (struct page *page);
+size_t vm_free_frames (void);
+void vm_add_swap (struct thread *t, int cnt);
+void vm_set_rss_limit (size_t limit);
+bool vm_reclaim (void);
+void vm_populate (void *start, void *end);
+void vm_discard (void *start, void *end);
+bool vm_check_access (void *va, bool write);
+void vm_save_fault_stats (void);
+void vm_print_stats (void);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
@@ -0,0 +1,66 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct file;
+struct page;
+struct shm_segment;
+
+/* 가상 메모리 영역(VMA).
+ * 사용자 주소 공간에서 페이지 단위로 정렬된 구간 [START, END)를 하나의
+ * 매핑으로 표현합니다. 실행 파일의 세그먼트, mmap 영역, 스택이 각각
+ * VMA 하나입니다. 구간 안의 struct page는 처음 폴트가 날 때에야 이
+ * VMA의 정보로부터 만들어지고 PAGES에 연결됩니다. */
+struct vma {
+	void *start;                /* 첫 페이지 주소 (포함) */
+	void *end;                  /* 마지막 페이지 다음 주소 (제외) */
+	enum vm_type type;          /* 페이지를 만들 때 쓸 타입 */
+	bool writable;              /* 사용자 쓰기 허용 여부 */
+	struct file *file;          /* 백업 파일. VMA가 소유하며, 없으면 NULL */
+	off_t ofs;                  /* START에 대응하는 파일 오프셋 */
+	size_t read_bytes;          /* START부터 파일에서 읽을 바이트, 나머지는 0 */
+	struct list pages;          /* 폴트로 만들어진 struct page 목록 */
+	int advice;                 /* madvise()로 알린 접근 방식 (MADV_*) */
+	struct shm_segment *shm;    /* 공유 메모리 세그먼트. VMA가 참조를 가짐 */
+	bool shareable;             /* 쓰기 금지된 실행 파일의 세그먼트 */
+
+	/* 구간 트리 */
+	struct vma *left, *right;   /* 자식 노드 */
+	void *max_end;              /* 서브트리 안 END의 최댓값 */
+	int height;                 /* AVL 높이 */
+};
+
+/* 서로 겹치지 않는 VMA들의 구간 트리.
+ * START를 키로 하는 AVL 트리이며, 각 노드가 서브트리의 최대 END를
+ * 들고 있어 주소나 구간에 겹치는 VMA를 O(log n)에 찾습니다. */
+struct vma_tree {
+	struct vma *root;
+};
+
+/* vma_tree_for_each()가 각 VMA에 대해 호출하는 함수.
+ * false를 반환하면 순회를 멈춥니다. */
+typedef bool vma_action_func (struct vma *vma, void *aux);
+
+struct vma *vma_create (enum vm_type type, void *start, size_t length,
+		bool writable, struct file *file, off_t ofs, size_t read_bytes);
+struct vma *vma_duplicate (const struct vma *vma);
+void vma_destroy (struct vma *vma);
+bool vma_has_file_data (const struct vma *vma, const void *va);
+bool vma_load_page (struct page *page, void *aux);
+
+void vma_tree_init (struct vma_tree *tree);
+bool vma_tree_insert (struct vma_tree *tree, struct vma *vma);
+void vma_tree_remove (struct vma_tree *tree, struct vma *vma);
+struct vma *vma_tree_find (struct vma_tree *tree, const void *va);
+struct vma *vma_tree_overlap (struct vma_tree *tree,
+		const void *start, const void *end);
+bool vma_tree_grow_down (struct vma_tree *tree, struct vma *vma,
+		void *start);
+bool vma_tree_for_each (struct vma_tree *tree, vma_action_func *action,
+		void *aux);
+
+#endif /* VM_VMA_H */
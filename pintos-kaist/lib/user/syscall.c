@@ -68,6 +68,15 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG3), \
 			((uint64_t) ARG4), \
 			0))
+
+#define syscall6(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4, ARG5) ( \
+		syscall(((uint64_t) NUMBER), \
+			((uint64_t) ARG0), \
+			((uint64_t) ARG1), \
+			((uint64_t) ARG2), \
+			((uint64_t) ARG3), \
+			((uint64_t) ARG4), \
+			((uint64_t) ARG5)))
 void
 halt (void) {
 	syscall0 (SYS_HALT);
@@ -145,16 +154,68 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+int
+pipe (int fds[2]) {
+	return syscall1 (SYS_PIPE, fds);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
 }
 
+void *
+mmap_flags (void *addr, size_t length, int writable, int fd, off_t offset,
+		int flags) {
+	return (void *) syscall6 (SYS_MMAP, addr, length, writable, fd, offset,
+			flags);
+}
+
 void
 munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+msync (void *addr, size_t length) {
+	return syscall2 (SYS_MSYNC, addr, length);
+}
+
+int
+shm_open (const char *name, size_t size) {
+	return syscall2 (SYS_SHM_OPEN, name, size);
+}
+
+void *
+shm_map (int id, void *addr) {
+	return (void *) syscall2 (SYS_SHM_MAP, id, addr);
+}
+
+int
+shm_unmap (void *addr) {
+	return syscall1 (SYS_SHM_UNMAP, addr);
+}
+
+int
+setrlimit (int resource, size_t limit) {
+	return syscall2 (SYS_SETRLIMIT, resource, limit);
+}
+
+int
+memstat (struct memstat *st) {
+	return syscall1 (SYS_MEMSTAT, st);
+}
+
+int
+faultstat (struct faultstat *st) {
+	return syscall1 (SYS_FAULTSTAT, st);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
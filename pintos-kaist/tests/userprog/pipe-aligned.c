@@ -0,0 +1,31 @@
+/* Writes two pages from a page-aligned buffer into a pipe while no
+   reader is waiting, then reads them back in the same process.
+   The write must not wait for a reader to appear. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 4096)
+
+static char wbuf[SIZE] __attribute__ ((aligned (4096)));
+static char rbuf[SIZE];
+
+void
+test_main (void)
+{
+  int fds[2];
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    wbuf[i] = i % 253;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], wbuf, SIZE) == SIZE, "write %d aligned bytes", SIZE);
+  CHECK (read (fds[0], rbuf, SIZE) == SIZE, "read %d bytes", SIZE);
+  compare_bytes (rbuf, wbuf, SIZE, 0, "pipe");
+
+  close (fds[1]);
+  CHECK (read (fds[0], rbuf, 1) == 0, "read after writer closed");
+  close (fds[0]);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-aligned) begin
+(pipe-aligned) pipe
+(pipe-aligned) write 8192 aligned bytes
+(pipe-aligned) read 8192 bytes
+(pipe-aligned) read after writer closed
+(pipe-aligned) end
+pipe-aligned: exit(0)
+EOF
+pass;
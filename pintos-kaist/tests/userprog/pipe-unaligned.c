@@ -0,0 +1,32 @@
+/* Writes just under a page from an unaligned buffer into a pipe
+   while no reader is waiting, then reads it back in the same
+   process. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 4095
+
+static char wbuf[SIZE + 1] __attribute__ ((aligned (4096)));
+static char rbuf[SIZE];
+
+void
+test_main (void)
+{
+  int fds[2];
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    wbuf[i + 1] = i % 253;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], wbuf + 1, SIZE) == SIZE,
+         "write %d unaligned bytes", SIZE);
+  CHECK (read (fds[0], rbuf, SIZE) == SIZE, "read %d bytes", SIZE);
+  compare_bytes (rbuf, wbuf + 1, SIZE, 0, "pipe");
+
+  close (fds[1]);
+  CHECK (read (fds[0], rbuf, 1) == 0, "read after writer closed");
+  close (fds[0]);
+}
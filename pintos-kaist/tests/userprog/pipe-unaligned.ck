@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-unaligned) begin
+(pipe-unaligned) pipe
+(pipe-unaligned) write 4095 unaligned bytes
+(pipe-unaligned) read 4095 bytes
+(pipe-unaligned) read after writer closed
+(pipe-unaligned) end
+pipe-unaligned: exit(0)
+EOF
+pass;
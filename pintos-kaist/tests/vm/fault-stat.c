@@ -0,0 +1,36 @@
+/* Writes to pages of .bss that were never touched before and
+   checks that faultstat counts one anonymous zero-fill fault for
+   each of them, with time recorded against the fault type. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 16
+
+/* The first page may share its contents with .data, so the test
+   only touches the pages after it. */
+static char buf[(PAGE_CNT + 1) * 4096];
+
+void
+test_main (void)
+{
+  struct faultstat before, after;
+  long long zero_cnt;
+  size_t i;
+
+  CHECK (faultstat (&before) == 0, "faultstat");
+  for (i = 1; i <= PAGE_CNT; i++)
+    buf[i * 4096] = i;
+  CHECK (faultstat (&after) == 0, "faultstat after touching %d pages",
+         PAGE_CNT);
+
+  zero_cnt = after.type[FAULT_ZERO].cnt - before.type[FAULT_ZERO].cnt;
+  if (zero_cnt < PAGE_CNT)
+    fail ("%lld zero-fill faults counted (should be at least %d)",
+          zero_cnt, PAGE_CNT);
+  if (after.type[FAULT_ZERO].cycles <= before.type[FAULT_ZERO].cycles)
+    fail ("no cycles recorded for zero-fill faults");
+  if (after.type[FAULT_INVALID].cnt != before.type[FAULT_INVALID].cnt)
+    fail ("invalid faults counted in a process that was not killed");
+}
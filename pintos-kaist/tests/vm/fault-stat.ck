@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-stat) begin
+(fault-stat) faultstat
+(fault-stat) faultstat after touching 16 pages
+(fault-stat) end
+EOF
+pass;
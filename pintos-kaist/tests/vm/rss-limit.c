@@ -0,0 +1,50 @@
+/* Caps the resident set with setrlimit, touches more pages than
+   the cap allows, and checks with memstat that the process kept
+   under the cap by swapping out its own pages.  Every page must
+   still read back what was written to it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+#define LIMIT 16
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  struct memstat st;
+  size_t i;
+
+  CHECK (memstat (&st) == 0, "memstat");
+  if (st.rss_limit != RLIM_INFINITY)
+    fail ("RSS limit is %zu at start (should be unlimited)", st.rss_limit);
+
+  CHECK (setrlimit (RLIMIT_RSS, 0) == -1, "setrlimit to 0 pages (must fail)");
+  CHECK (setrlimit (RLIMIT_RSS + 1, LIMIT) == -1,
+         "setrlimit of unknown resource (must fail)");
+  CHECK (setrlimit (RLIMIT_RSS, LIMIT) == 0, "setrlimit to %d pages", LIMIT);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * 4096] = i;
+
+  CHECK (memstat (&st) == 0, "memstat after touching %d pages", PAGE_CNT);
+  if (st.rss_limit != LIMIT)
+    fail ("RSS limit is %zu (should be %d)", st.rss_limit, LIMIT);
+  if (st.rss > LIMIT)
+    fail ("RSS is %zu pages (limit is %d)", st.rss, LIMIT);
+  if (st.swap == 0)
+    fail ("no pages were swapped out");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * 4096] != (char) i)
+      fail ("page %zu reads %02hhx (should be %02hhx)",
+            i, buf[i * 4096], (char) i);
+
+  CHECK (setrlimit (RLIMIT_RSS, RLIM_INFINITY) == 0, "remove RSS limit");
+  CHECK (memstat (&st) == 0, "memstat after removing limit");
+  if (st.rss_limit != RLIM_INFINITY)
+    fail ("RSS limit is %zu (should be unlimited)", st.rss_limit);
+}
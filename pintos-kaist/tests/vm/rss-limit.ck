@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) memstat
+(rss-limit) setrlimit to 0 pages (must fail)
+(rss-limit) setrlimit of unknown resource (must fail)
+(rss-limit) setrlimit to 16 pages
+(rss-limit) memstat after touching 64 pages
+(rss-limit) remove RSS limit
+(rss-limit) memstat after removing limit
+(rss-limit) end
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Maps one shared-memory segment at two addresses and checks that
+   writes through one mapping show up in the other, and that the
+   data outlives the mapping that wrote it and, while the process
+   still has the segment open, every mapping. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (3 * 4096)
+
+void
+test_main (void)
+{
+  char *a = (char *) 0x10000000;
+  char *b = (char *) 0x20000000;
+  size_t i;
+  int id;
+
+  CHECK ((id = shm_open ("share", SIZE)) >= 0, "shm_open \"share\"");
+  CHECK (shm_open ("share", SIZE) == id, "shm_open \"share\" again");
+  CHECK (shm_map (id, a) == a, "map segment at 0x10000000");
+  CHECK (shm_map (id, b) == b, "map segment at 0x20000000");
+
+  for (i = 0; i < SIZE; i++)
+    if (b[i] != 0)
+      fail ("byte %zu of new segment is %02hhx (should be 0)", i, b[i]);
+
+  for (i = 0; i < SIZE; i++)
+    a[i] = i % 251;
+  for (i = 0; i < SIZE; i++)
+    if (b[i] != (char) (i % 251))
+      fail ("byte %zu read through second mapping is %02hhx", i, b[i]);
+
+  CHECK (shm_unmap (a) == 0, "unmap first mapping");
+  for (i = 0; i < SIZE; i++)
+    if (b[i] != (char) (i % 251))
+      fail ("byte %zu lost after unmap is %02hhx", i, b[i]);
+
+  CHECK (shm_unmap (b) == 0, "unmap second mapping");
+  CHECK (shm_unmap (b) == -1, "unmap again (must fail)");
+
+  CHECK (shm_map (id, a) == a, "map segment again at 0x10000000");
+  for (i = 0; i < SIZE; i++)
+    if (a[i] != (char) (i % 251))
+      fail ("byte %zu lost after last unmap is %02hhx", i, a[i]);
+  CHECK (shm_unmap (a) == 0, "unmap third mapping");
+}
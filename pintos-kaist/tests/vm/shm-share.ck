@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-share) begin
+(shm-share) shm_open "share"
+(shm-share) shm_open "share" again
+(shm-share) map segment at 0x10000000
+(shm-share) map segment at 0x20000000
+(shm-share) unmap first mapping
+(shm-share) unmap second mapping
+(shm-share) unmap again (must fail)
+(shm-share) map segment again at 0x10000000
+(shm-share) unmap third mapping
+(shm-share) end
+EOF
+pass;
@@ -31,11 +31,17 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/ksm.h"
+#include "vm/kswapd.h"
+#include "vm/share.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "filesys/dcache.h"
+#include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/page_cache.h"
 #endif
 
 /* 커널 매핑만 포함하는 페이지 맵 레벨 4 */
@@ -152,19 +158,32 @@ paging_init (uint64_t mem_end) {
 	extern char start, _end_kernel_text;
 	// 물리 주소 [0 ~ mem_end]를 
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end]로 매핑한다.
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	// 커널 코드와 겹치지 않는 2 MiB 영역은 큰 페이지 하나로 매핑해서
+	// 페이지 테이블과 TLB 항목을 아낀다.
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
 		perm = PTE_P | PTE_W;
+		if (pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end
+				&& (va + LARGE_PGSIZE <= (uint64_t) &start
+					|| va >= (uint64_t) &_end_kernel_text)) {
+			if ((pte = pml4e_walk_pde (pml4, va, 1)) != NULL)
+				*pte = pa | perm | PTE_PS;
+			pa += LARGE_PGSIZE;
+			continue;
+		}
+
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// cr3 레지스터를 다시 로드한다
 	pml4_activate(0);
+	pml4_pcid_init ();
 }
 
 /* 커널 커맨드라인을 단어별로 분할하고 argv와 같은 배열로 반환한다 */
@@ -225,6 +244,14 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fa"))
+			fault_around_pages = atoi (value);
+		else if (!strcmp (name, "-ksm"))
+			ksm_pages_to_scan = atoi (value);
+		else if (!strcmp (name, "-kswapd"))
+			kswapd_low_wmark = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -326,6 +353,11 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -fa=COUNT          Fault around up to COUNT file pages.\n"
+			"  -ksm=COUNT         Enable KSM, scanning COUNT frames per pass.\n"
+			"  -kswapd=COUNT      Enable kswapd, reclaiming below COUNT free frames.\n"
 #endif
 			);
 	power_off ();
@@ -354,10 +386,23 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	page_cache_print_stats ();
+	dcache_print_stats ();
+#ifdef EFILESYS
+	fat_print_stats ();
+#endif
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
+	pml4_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+	vm_file_print_stats ();
+	kswapd_print_stats ();
+	ksm_print_stats ();
+	share_print_stats ();
+#endif
 }
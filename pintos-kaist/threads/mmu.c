@@ -1,13 +1,42 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* 프로세스 문맥 식별자 (PCID).
+ * PCID를 켜면 TLB 항목에 주소 공간의 PCID가 붙으므로, CR3를 바꿔도 TLB를
+ * 비우지 않고 다른 주소 공간의 항목을 남겨 둘 수 있습니다. 각 pml4는
+ * 자신이 놓인 물리 페이지 번호로 PCID를 정하므로 따로 할당하거나 찾을
+ * 필요가 없습니다. 두 pml4의 PCID가 겹치면 PCID_OWNER가 바뀌므로 그
+ * PCID로 전환할 때 TLB를 비웁니다.
+ *
+ * 현재 주소 공간이 아닌 pml4의 항목을 바꾸면 (축출, KSM, 쓰기 시 복사)
+ * invlpg로는 그 PCID의 TLB 항목을 지울 수 없으므로 PCID_STALE에 표시해
+ * 두고, 그 pml4로 다시 전환할 때 TLB를 비웁니다. */
+#define PCID_CNT 4096                   /* CR3 하위 12비트 */
+#define CR3_NOFLUSH (1ULL << 63)        /* 전환할 때 TLB를 비우지 않음 */
+#define CR4_PCIDE (1 << 17)             /* PCID 사용 */
+#define CPUID_PCID (1 << 17)            /* CPUID.01H:ECX의 PCID 지원 비트 */
+
+static bool pcid_enabled;
+static uint64_t *pcid_owner[PCID_CNT];  /* 이 PCID로 TLB를 채운 pml4 */
+static bool pcid_stale[PCID_CNT];       /* 전환할 때 TLB를 비워야 함 */
+
+/* 통계 */
+static long long cr3_load_cnt;          /* CR3를 다시 쓴 횟수 */
+static long long cr3_flush_cnt;         /* 그중 TLB를 비운 횟수 */
+static long long cr3_skip_cnt;          /* 같은 주소 공간이라 건너뛴 횟수 */
+
+/* 커널 직접 매핑의 2 MiB 큰 페이지가 VA를 덮고 있으면, CREATE가 false일
+   때는 큰 페이지의 페이지 디렉터리 항목을 그대로 반환합니다. 큰 페이지는
+   쪼개지 않으므로 CREATE가 true이면 null 포인터를 반환합니다. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -23,6 +52,8 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		if (is_large_pte (&pdp[idx]))
+			return create ? NULL : &pdp[idx];
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -86,6 +117,27 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* 페이지 맵 레벨 4(pml4)에서 가상 주소 VA를 덮는 페이지 디렉터리 항목의
+   주소를 반환합니다. 중간 테이블이 없으면 CREATE가 true일 때 새로 만들고,
+   false일 때는 null 포인터를 반환합니다. paging_init()이 커널 직접
+   매핑을 2 MiB 큰 페이지로 만들 때 씁니다. */
+uint64_t *
+pml4e_walk_pde (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *table = pml4;
+
+	for (uint64_t shift = PML4SHIFT; shift > PDXSHIFT; shift -= 9) {
+		uint64_t *e = &table[(va >> shift) & 0x1FF];
+		if (!(*e & PTE_P)) {
+			uint64_t *new_page;
+			if (!create || (new_page = palloc_get_page (PAL_ZERO)) == NULL)
+				return NULL;
+			*e = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*e));
+	}
+	return &table[PDX (va)];
+}
+
 /* 커널 가상 주소에 대한 매핑을 가지지만 사용자 가상 주소에 대한 매핑은 없는
    새로운 페이지 맵 레벨 4(pml4)를 생성합니다.
    새로운 페이지 디렉터리를 반환하거나, 메모리 할당이 실패하면 null 포인터를 반환합니다. */
@@ -119,7 +171,15 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (is_large_pte (&pdp[i])) {
+			/* 커널 직접 매핑의 큰 페이지는 페이지 디렉터리 항목을
+			   그대로 넘깁니다. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -182,12 +242,60 @@ pdpe_destroy (uint64_t *pdpe) {
 	palloc_free_page ((void *) pdpe);
 }
 
+/* PML4의 PCID를 반환합니다. */
+static unsigned
+pml4_pcid (uint64_t *pml4) {
+	return (vtop (pml4) >> PGBITS) % PCID_CNT;
+}
+
+/* PML4가 지금 CR3에 올라 있으면 true를 반환합니다. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* PML4의 VA에 대한 페이지 테이블 항목 PTE를 NEW로 바꾸고 TLB에 남아 있을
+   수 있는 옛 항목을 무효화합니다. 현재 주소 공간이면 invlpg로 바로 지우고,
+   아니면 PML4의 PCID를 낡음으로 표시합니다. 둘 사이에 PML4로 전환되어
+   옛 항목을 다시 쓰지 않도록 인터럽트를 끄고 합니다. */
+static void
+pte_update (uint64_t *pml4, uint64_t *pte, uint64_t new, const void *va) {
+	enum intr_level old_level = intr_disable ();
+
+	*pte = new;
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled && pcid_owner[pml4_pcid (pml4)] == pml4)
+		pcid_stale[pml4_pcid (pml4)] = true;
+	intr_set_level (old_level);
+}
+
+/* CPU가 지원하면 PCID를 켭니다. 커널 전용 pml4를 PCID 0으로 올린 뒤에
+   호출해야 합니다. */
+void
+pml4_pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if ((ecx & CPUID_PCID) == 0 || (rcr3 () & (PCID_CNT - 1)) != 0)
+		return;
+
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
 /* pml4e를 파괴하고 그것이 참조하는 모든 페이지를 해제합니다. */
 void
 pml4_destroy (uint64_t *pml4) {
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
+	ASSERT (!pml4_is_active (pml4));
+
+	/* 같은 페이지에 새로 만들어지는 pml4가 이 pml4의 TLB 항목을 물려받지
+	   않도록 합니다. */
+	if (pcid_owner[pml4_pcid (pml4)] == pml4)
+		pcid_owner[pml4_pcid (pml4)] = NULL;
 
 	/* PML4 (vaddr) >= 1이면 정의상 커널 공간입니다. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
@@ -196,10 +304,46 @@ pml4_destroy (uint64_t *pml4) {
 	palloc_free_page ((void *) pml4);
 }
 
-/* 페이지 디렉터리 PD를 CPU의 페이지 디렉터리 베이스 레지스터에 로드합니다. */
+/* 페이지 디렉터리 PD를 CPU의 페이지 디렉터리 베이스 레지스터에 로드합니다.
+   이미 올라 있는 주소 공간이면 아무것도 하지 않습니다. PCID를 쓰면 그
+   PCID의 TLB 항목이 여전히 유효할 때 TLB를 비우지 않고 전환합니다. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	enum intr_level old_level;
+	uint64_t cr3;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+
+	old_level = intr_disable ();
+	if (pml4_is_active (pml4))
+		cr3_skip_cnt++;
+	else if (!pcid_enabled) {
+		lcr3 (vtop (pml4));
+		cr3_load_cnt++;
+		cr3_flush_cnt++;
+	} else {
+		unsigned pcid = pml4_pcid (pml4);
+
+		cr3 = vtop (pml4) | pcid;
+		if (pcid_owner[pcid] == pml4 && !pcid_stale[pcid])
+			cr3 |= CR3_NOFLUSH;
+		else
+			cr3_flush_cnt++;
+		pcid_owner[pcid] = pml4;
+		pcid_stale[pcid] = false;
+		lcr3 (cr3);
+		cr3_load_cnt++;
+	}
+	intr_set_level (old_level);
+}
+
+/* 주소 공간 전환 통계를 출력합니다. */
+void
+pml4_print_stats (void) {
+	printf ("Address spaces: PCID %s, %lld CR3 loads, %lld TLB flushes, "
+			"%lld skipped\n", pcid_enabled ? "on" : "off",
+			cr3_load_cnt, cr3_flush_cnt, cr3_skip_cnt);
 }
 
 /* pml4에서 사용자 가상 주소 UADDR에 해당하는 물리 주소를 찾습니다.
@@ -231,10 +375,16 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	ASSERT (pml4 != base_pml4);
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
+	uint64_t new = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
 
-	if (pte)
-		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
-	return pte != NULL;
+	if (pte == NULL)
+		return false;
+	/* 존재하는 항목을 덮어쓸 때만 TLB에 옛 항목이 남아 있을 수 있습니다. */
+	if (*pte & PTE_P)
+		pte_update (pml4, pte, new, upage);
+	else
+		*pte = new;
+	return true;
 }
 
 /* 페이지 디렉터리 PD에서 사용자 가상 페이지 UPAGE를 "존재하지 않음"으로 표시합니다.
@@ -249,11 +399,8 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
-	if (pte != NULL && (*pte & PTE_P) != 0) {
-		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
-	}
+	if (pte != NULL && (*pte & PTE_P) != 0)
+		pte_update (pml4, pte, *pte & ~PTE_P, upage);
 }
 
 /* PML4의 가상 페이지 VPAGE에 대한 PTE가 더티인지, 즉 PTE가 설치된 이후로
@@ -269,15 +416,9 @@ pml4_is_dirty (uint64_t *pml4, const void *vpage) {
 void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
-	if (pte) {
-		if (dirty)
-			*pte |= PTE_D;
-		else
-			*pte &= ~(uint32_t) PTE_D;
-
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
-	}
+	if (pte)
+		pte_update (pml4, pte,
+				dirty ? *pte | PTE_D : *pte & ~(uint32_t) PTE_D, vpage);
 }
 
 /* PML4의 가상 페이지 VPAGE에 대한 PTE가 최근에 접근되었는지,
@@ -293,13 +434,7 @@ pml4_is_accessed (uint64_t *pml4, const void *vpage) {
 void
 pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
-	if (pte) {
-		if (accessed)
-			*pte |= PTE_A;
-		else
-			*pte &= ~(uint32_t) PTE_A;
-
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
-	}
+	if (pte)
+		pte_update (pml4, pte,
+				accessed ? *pte | PTE_A : *pte & ~(uint32_t) PTE_A, vpage);
 }
@@ -324,6 +324,32 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* 사용자 풀에서 비어 있는 페이지 수를 반환합니다.
+   비트맵 전체를 세므로 자주 부르지 마세요. */
+size_t
+palloc_user_free_cnt (void) {
+	size_t cnt;
+
+	lock_acquire (&user_pool.lock);
+	cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
+	lock_release (&user_pool.lock);
+	return cnt;
+}
+
+/* 사용자 풀의 첫 페이지의 커널 가상 주소를 반환합니다. */
+void *
+palloc_user_base (void) {
+	return user_pool.base;
+}
+
+/* 사용자 풀의 전체 페이지 수를 반환합니다. 사용자 풀의 페이지는
+   palloc_user_base()부터 이 수만큼 연속되어 있습니다. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
 /* 풀 P를 START에서 시작하여 END에서 끝나도록 초기화합니다 */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -79,6 +79,7 @@ kill (struct intr_frame *f) {
 			printf ("%s: dying due to interrupt %#04llx (%s).\n",
 					thread_name (), f->vec_no, intr_name (f->vec_no));
 			intr_dump_frame (f);
+			thread_current ()->exit_status = -1;
 			thread_exit ();
 
 		case SEL_KCSEG:
@@ -0,0 +1,309 @@
+/* pipe.c: 프로세스 사이의 파이프.
+ *
+ * 파이프는 커널 안의 링 버퍼 하나와 읽기 끝, 쓰기 끝으로 이루어집니다.
+ * 버퍼는 한 페이지로 시작해, 쓰는 쪽이 가득 찬 버퍼를 만나면
+ * PIPE_MAX_PAGES까지 두 배씩 늘어납니다. 버퍼가 비었으면 읽는 쪽이,
+ * 최대 크기로 가득 찼으면 쓰는 쪽이 조건 변수에서 기다립니다.
+ *
+ * 페이지 단위로 정렬된 한 페이지 이상의 쓰기는, 읽는 쪽이 이미
+ * 기다리고 있거나 버퍼가 최대 크기로 가득 차 어차피 기다려야 할 때
+ * 버퍼를 거치지 않습니다. 쓰는 쪽이 자기 사용자 페이지를 고정해 그 커널
+ * 주소들을 빌려 주면, 읽는 쪽이 거기서 자기 버퍼로 바로 복사하므로
+ * 복사가 한 번으로 줄어듭니다. 쓰는 쪽은 빌려 준 페이지를 다 읽을
+ * 때까지 기다리므로, 그 밖의 경우에는 버퍼에 복사하고 바로 돌아갑니다.
+ * 그래야 한 프로세스가 파이프에 쓴 뒤 읽어도 막히지 않습니다. */
+
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* 링 버퍼의 최대 크기 (페이지) */
+#define PIPE_MAX_PAGES 16
+
+/* 한 번에 빌려 줄 수 있는 최대 페이지 수 */
+#define PIPE_LOAN_PAGES 16
+
+struct pipe {
+	struct lock lock;           /* 아래 모든 필드 보호 */
+	struct condition readable;  /* 읽을 것이 생겼거나 쓰기 끝이 모두 닫힘 */
+	struct condition writable;  /* 빈 곳이 생겼거나 읽기 끝이 모두 닫힘 */
+	int readers;                /* 열린 읽기 끝 수 */
+	int writers;                /* 열린 쓰기 끝 수 */
+	int read_waiters;           /* READABLE에서 기다리는 읽는 쪽 수 */
+
+	/* 링 버퍼 */
+	uint8_t *buf;               /* 페이지 단위로 할당한 버퍼 */
+	size_t size;                /* 버퍼 크기 (바이트) */
+	size_t head;                /* 다음에 읽을 위치 */
+	size_t len;                 /* 들어 있는 바이트 수 */
+
+	/* 쓰는 쪽이 빌려 준 페이지. LOAN_CNT가 0이면 없습니다. */
+	void *loan[PIPE_LOAN_PAGES];  /* 고정된 사용자 페이지의 커널 주소 */
+	size_t loan_cnt;            /* 빌려 준 페이지 수 */
+	size_t loan_ofs;            /* 빌려 준 페이지에서 다음에 읽을 위치 */
+};
+
+/* 읽기 끝과 쓰기 끝이 하나씩 열린 새 파이프를 만듭니다. 메모리가
+ * 부족하면 NULL을 반환합니다. */
+struct pipe *
+pipe_create (void) {
+	struct pipe *pipe = malloc (sizeof *pipe);
+
+	if (pipe == NULL)
+		return NULL;
+	pipe->buf = palloc_get_page (0);
+	if (pipe->buf == NULL) {
+		free (pipe);
+		return NULL;
+	}
+	lock_init (&pipe->lock);
+	cond_init (&pipe->readable);
+	cond_init (&pipe->writable);
+	pipe->readers = pipe->writers = 1;
+	pipe->read_waiters = 0;
+	pipe->size = PGSIZE;
+	pipe->head = pipe->len = 0;
+	pipe->loan_cnt = pipe->loan_ofs = 0;
+	return pipe;
+}
+
+/* PIPE의 읽기 끝(WRITE_END가 false) 또는 쓰기 끝 하나를 닫습니다.
+ * 두 끝이 모두 닫히면 파이프를 해제합니다. */
+void
+pipe_close (struct pipe *pipe, bool write_end) {
+	bool dead;
+
+	lock_acquire (&pipe->lock);
+	if (write_end) {
+		pipe->writers--;
+		cond_broadcast (&pipe->readable, &pipe->lock);
+	} else {
+		pipe->readers--;
+		cond_broadcast (&pipe->writable, &pipe->lock);
+	}
+	dead = pipe->readers == 0 && pipe->writers == 0;
+	lock_release (&pipe->lock);
+
+	if (dead) {
+		palloc_free_multiple (pipe->buf, pipe->size / PGSIZE);
+		free (pipe);
+	}
+}
+
+/* 링 버퍼에서 최대 SIZE 바이트를 BUFFER로 꺼내고 꺼낸 바이트 수를
+ * 반환합니다. PIPE->LOCK을 쥐고 호출합니다. */
+static size_t
+ring_get (struct pipe *pipe, uint8_t *buffer, size_t size) {
+	size_t done = 0;
+
+	while (done < size && pipe->len > 0) {
+		size_t chunk = min (size - done, min (pipe->len,
+					pipe->size - pipe->head));
+
+		memcpy (buffer + done, pipe->buf + pipe->head, chunk);
+		pipe->head = (pipe->head + chunk) % pipe->size;
+		pipe->len -= chunk;
+		done += chunk;
+	}
+	return done;
+}
+
+/* BUFFER의 최대 SIZE 바이트를 링 버퍼에 넣고 넣은 바이트 수를
+ * 반환합니다. PIPE->LOCK을 쥐고 호출합니다. */
+static size_t
+ring_put (struct pipe *pipe, const uint8_t *buffer, size_t size) {
+	size_t done = 0;
+
+	while (done < size && pipe->len < pipe->size) {
+		size_t tail = (pipe->head + pipe->len) % pipe->size;
+		size_t chunk = min (size - done, min (pipe->size - pipe->len,
+					pipe->size - tail));
+
+		memcpy (pipe->buf + tail, buffer + done, chunk);
+		pipe->len += chunk;
+		done += chunk;
+	}
+	return done;
+}
+
+/* 가득 찬 링 버퍼를 두 배로 늘립니다. 이미 최대 크기이거나 메모리가
+ * 부족하면 false를 반환합니다. PIPE->LOCK을 쥐고 호출합니다. */
+static bool
+ring_grow (struct pipe *pipe) {
+	size_t pages = pipe->size / PGSIZE;
+	uint8_t *buf;
+	size_t len;
+
+	if (pages * 2 > PIPE_MAX_PAGES)
+		return false;
+	buf = palloc_get_multiple (0, pages * 2);
+	if (buf == NULL)
+		return false;
+
+	/* 내용을 새 버퍼의 앞으로 펴서 옮깁니다. */
+	len = ring_get (pipe, buf, pipe->len);
+	palloc_free_multiple (pipe->buf, pages);
+	pipe->buf = buf;
+	pipe->size = pages * 2 * PGSIZE;
+	pipe->head = 0;
+	pipe->len = len;
+	return true;
+}
+
+/* 빌려 받은 페이지에서 최대 SIZE 바이트를 BUFFER로 복사하고 복사한
+ * 바이트 수를 반환합니다. 다 읽었으면 쓰는 쪽을 깨웁니다.
+ * PIPE->LOCK을 쥐고 호출합니다. */
+static size_t
+loan_get (struct pipe *pipe, uint8_t *buffer, size_t size) {
+	size_t total = pipe->loan_cnt * PGSIZE;
+	size_t done = 0;
+
+	while (done < size && pipe->loan_ofs < total) {
+		size_t ofs = pipe->loan_ofs % PGSIZE;
+		size_t chunk = min (size - done, PGSIZE - ofs);
+
+		memcpy (buffer + done,
+				(uint8_t *) pipe->loan[pipe->loan_ofs / PGSIZE] + ofs, chunk);
+		pipe->loan_ofs += chunk;
+		done += chunk;
+	}
+	if (pipe->loan_ofs == total)
+		cond_broadcast (&pipe->writable, &pipe->lock);
+	return done;
+}
+
+/* PIPE에서 최대 SIZE 바이트를 BUFFER로 읽고 읽은 바이트 수를 반환합니다.
+ * 읽을 것이 없으면 생길 때까지 기다리고, 쓰기 끝이 모두 닫혔으면 0을
+ * 반환합니다. */
+int
+pipe_read (struct pipe *pipe, void *buffer, size_t size) {
+	size_t done = 0;
+
+	if (size == 0)
+		return 0;
+
+	lock_acquire (&pipe->lock);
+	while (pipe->len == 0 && pipe->loan_ofs == pipe->loan_cnt * PGSIZE
+			&& pipe->writers > 0) {
+		pipe->read_waiters++;
+		cond_wait (&pipe->readable, &pipe->lock);
+		pipe->read_waiters--;
+	}
+
+	/* 빌려 준 페이지는 버퍼에 든 내용 뒤에 쓴 것이므로 버퍼를 먼저
+	 * 읽습니다. */
+	done = ring_get (pipe, buffer, size);
+	if (done > 0)
+		cond_broadcast (&pipe->writable, &pipe->lock);
+	done += loan_get (pipe, (uint8_t *) buffer + done, size - done);
+	lock_release (&pipe->lock);
+	return done;
+}
+
+/* 현재 프로세스의 사용자 페이지 UPAGE를 축출되지 않게 고정하고 커널
+ * 주소를 반환합니다. 프레임에 올라와 있지 않으면 NULL을 반환합니다. */
+static void *
+pin_user_page (void *upage) {
+#ifdef VM
+	struct page *page = spt_find_page (&thread_current ()->spt, upage);
+
+	if (page == NULL || !vm_pin_frame (page))
+		return NULL;
+	return page->frame->kva;
+#else
+	return pml4_get_page (thread_current ()->pml4, upage);
+#endif
+}
+
+/* pin_user_page()로 고정한 UPAGE를 풉니다. */
+static void
+unpin_user_page (void *upage UNUSED) {
+#ifdef VM
+	vm_unpin_frame (spt_find_page (&thread_current ()->spt, upage));
+#endif
+}
+
+/* BUFFER부터 CNT개 페이지를 고정해 읽는 쪽에 빌려 주고 다 읽힐 때까지
+ * 기다립니다. 앞쪽에서 고정할 수 있는 페이지까지만 빌려 주며, 빌려 준
+ * 페이지 중 읽힌 바이트 수를 반환합니다. PIPE->LOCK을 쥐고 호출합니다. */
+static size_t
+pipe_loan (struct pipe *pipe, const uint8_t *buffer, size_t cnt) {
+	size_t done, i;
+
+	ASSERT (pipe->loan_cnt == 0);
+
+	for (i = 0; i < cnt && i < PIPE_LOAN_PAGES; i++) {
+		void *kva = pin_user_page ((void *) (buffer + i * PGSIZE));
+		if (kva == NULL)
+			break;
+		pipe->loan[i] = kva;
+	}
+	if (i == 0)
+		return 0;
+
+	pipe->loan_cnt = i;
+	pipe->loan_ofs = 0;
+	cond_broadcast (&pipe->readable, &pipe->lock);
+	while (pipe->loan_ofs < pipe->loan_cnt * PGSIZE && pipe->readers > 0)
+		cond_wait (&pipe->writable, &pipe->lock);
+
+	done = pipe->loan_ofs;
+	pipe->loan_cnt = pipe->loan_ofs = 0;
+	while (i-- > 0)
+		unpin_user_page ((void *) (buffer + i * PGSIZE));
+	/* 빌려 준 페이지를 기다리던 다른 쓰는 쪽을 깨웁니다. */
+	cond_broadcast (&pipe->writable, &pipe->lock);
+	return done;
+}
+
+/* BUFFER의 SIZE 바이트를 PIPE에 쓰고 쓴 바이트 수를 반환합니다. 빈 곳이
+ * 없으면 생길 때까지 기다립니다. 읽기 끝이 모두 닫혀 있으면 더 쓰지
+ * 않고, 아무것도 못 썼다면 -1을 반환합니다. */
+int
+pipe_write (struct pipe *pipe, const void *buffer, size_t size) {
+	const uint8_t *src = buffer;
+	size_t done = 0;
+
+	lock_acquire (&pipe->lock);
+	while (done < size && pipe->readers > 0) {
+		size_t left = size - done;
+		bool full;
+
+		/* 다른 쓰는 쪽이 빌려 준 페이지가 다 읽히기를 기다립니다. */
+		if (pipe->loan_cnt > 0) {
+			cond_wait (&pipe->writable, &pipe->lock);
+			continue;
+		}
+
+		/* 페이지 단위로 정렬된 큰 쓰기는 읽는 쪽이 기다리고 있거나 버퍼가
+		 * 더 늘 수 없게 가득 찼을 때만 빌려 줍니다. */
+		full = pipe->len == pipe->size && !ring_grow (pipe);
+		if (pg_ofs (src + done) == 0 && left >= PGSIZE
+				&& (full || pipe->read_waiters > 0)) {
+			size_t loaned = pipe_loan (pipe, src + done, left / PGSIZE);
+			if (loaned > 0) {
+				done += loaned;
+				continue;
+			}
+		}
+
+		if (full) {
+			cond_wait (&pipe->writable, &pipe->lock);
+			continue;
+		}
+		done += ring_put (pipe, src + done, left);
+		cond_broadcast (&pipe->readable, &pipe->lock);
+	}
+	lock_release (&pipe->lock);
+	return done > 0 || size == 0 ? (int) done : -1;
+}
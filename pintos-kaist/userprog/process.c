@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "userprog/gdt.h"
+#include "userprog/pipe.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -13,6 +14,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -22,6 +24,24 @@
 #include "vm/vm.h"
 #endif
 
+/* 파일 디스크립터가 가리키는 객체의 종류 */
+enum fd_type {
+	FD_NONE,                    /* 닫힌 디스크립터 */
+	FD_FILE,                    /* 열린 파일 */
+	FD_PIPE_READ,               /* 파이프의 읽기 끝 */
+	FD_PIPE_WRITE,              /* 파이프의 쓰기 끝 */
+};
+
+/* 파일 디스크립터 테이블의 항목 */
+struct fd {
+	enum fd_type type;
+	void *obj;                  /* struct file 또는 struct pipe */
+};
+
+/* 파일 디스크립터 범위. 0과 1은 콘솔 입출력입니다. */
+#define FD_MIN 2
+#define FD_MAX ((int) (PGSIZE / sizeof (struct fd)))
+
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
@@ -172,6 +192,9 @@ process_exec (void *f_name) {
 
 	/* 먼저 현재 컨텍스트를 종료합니다 */
 	process_cleanup ();
+#ifdef VM
+	supplemental_page_table_init (&thread_current ()->spt);
+#endif
 
 	/* 그리고 바이너리를 로드합니다 */
 	success = load (file_name, &_if);
@@ -204,13 +227,115 @@ process_wait (tid_t child_tid UNUSED) {
 void
 process_exit (void) {
 	struct thread *curr = thread_current ();
-	/* TODO: 여기에 코드를 작성하세요.
-	 * TODO: 프로세스 종료 메시지를 구현하세요 (project2/process_termination.html 참조).
-	 * TODO: 여기에 프로세스 리소스 정리를 구현하는 것을 권장합니다. */
+	int fd;
+
+	/* 사용자 프로세스였다면 종료 메시지를 출력합니다. */
+	if (curr->pml4 != NULL) {
+		printf ("%s: exit(%d)\n", curr->name, curr->exit_status);
+#ifdef VM
+		vm_save_fault_stats ();
+#endif
+	}
+
+	if (curr->fd_table != NULL) {
+		for (fd = FD_MIN; fd < FD_MAX; fd++)
+			process_close_fd (fd);
+		palloc_free_page (curr->fd_table);
+		curr->fd_table = NULL;
+	}
 
 	process_cleanup ();
 }
 
+/* TYPE 종류의 객체 OBJ를 현재 프로세스의 파일 디스크립터 테이블에 넣고
+ * 새 디스크립터를 반환합니다. 테이블이 가득 찼거나 메모리가 없으면 -1을
+ * 반환합니다. */
+static int
+process_add_fd (enum fd_type type, void *obj) {
+	struct thread *curr = thread_current ();
+	int fd;
+
+	if (curr->fd_table == NULL) {
+		curr->fd_table = palloc_get_page (PAL_ZERO);
+		if (curr->fd_table == NULL)
+			return -1;
+	}
+
+	for (fd = FD_MIN; fd < FD_MAX; fd++)
+		if (curr->fd_table[fd].type == FD_NONE) {
+			curr->fd_table[fd].type = type;
+			curr->fd_table[fd].obj = obj;
+			return fd;
+		}
+	return -1;
+}
+
+/* 현재 프로세스의 파일 디스크립터 FD가 TYPE 종류이면 그 객체를, 아니면
+ * NULL을 반환합니다. */
+static void *
+process_get_fd (int fd, enum fd_type type) {
+	struct thread *curr = thread_current ();
+
+	if (curr->fd_table == NULL || fd < FD_MIN || fd >= FD_MAX
+			|| curr->fd_table[fd].type != type)
+		return NULL;
+	return curr->fd_table[fd].obj;
+}
+
+/* FILE을 현재 프로세스의 파일 디스크립터 테이블에 넣고 새 디스크립터를
+ * 반환합니다. 테이블이 가득 찼거나 메모리가 없으면 -1을 반환합니다. */
+int
+process_add_file (struct file *file) {
+	return process_add_fd (FD_FILE, file);
+}
+
+/* PIPE의 읽기 끝 또는 WRITE_END이면 쓰기 끝을 현재 프로세스의 파일
+ * 디스크립터 테이블에 넣고 새 디스크립터를 반환합니다. 실패하면 -1을
+ * 반환합니다. */
+int
+process_add_pipe (struct pipe *pipe, bool write_end) {
+	return process_add_fd (write_end ? FD_PIPE_WRITE : FD_PIPE_READ, pipe);
+}
+
+/* 현재 프로세스의 파일 디스크립터 FD가 가리키는 파일을 반환합니다.
+ * 열린 파일이 아니면 NULL을 반환합니다. */
+struct file *
+process_get_file (int fd) {
+	return process_get_fd (fd, FD_FILE);
+}
+
+/* 현재 프로세스의 파일 디스크립터 FD가 파이프의 읽기 끝 또는 WRITE_END이면
+ * 쓰기 끝일 때 그 파이프를 반환합니다. 아니면 NULL을 반환합니다. */
+struct pipe *
+process_get_pipe (int fd, bool write_end) {
+	return process_get_fd (fd, write_end ? FD_PIPE_WRITE : FD_PIPE_READ);
+}
+
+/* 현재 프로세스의 파일 디스크립터 FD를 닫습니다. */
+void
+process_close_fd (int fd) {
+	struct thread *curr = thread_current ();
+	struct fd *entry;
+
+	if (curr->fd_table == NULL || fd < FD_MIN || fd >= FD_MAX)
+		return;
+
+	entry = &curr->fd_table[fd];
+	switch (entry->type) {
+		case FD_FILE:
+			file_close (entry->obj);
+			break;
+		case FD_PIPE_READ:
+		case FD_PIPE_WRITE:
+			pipe_close (entry->obj, entry->type == FD_PIPE_WRITE);
+			break;
+		case FD_NONE:
+			return;
+	}
+	entry->type = FD_NONE;
+	entry->obj = NULL;
+}
+
 /* 현재 프로세스의 리소스를 해제합니다. */
 static void
 process_cleanup (void) {
@@ -220,6 +345,10 @@ process_cleanup (void) {
 	supplemental_page_table_kill (&curr->spt);
 #endif
 
+	/* 지연 로딩이 끝났으므로 실행 파일을 닫고 쓰기를 다시 허용합니다. */
+	file_close (curr->exec_file);
+	curr->exec_file = NULL;
+
 	uint64_t *pml4;
 	/* 현재 프로세스의 페이지 디렉터리를 파괴하고 커널 전용
 	 * 페이지 디렉터리로 다시 전환합니다. */
@@ -240,8 +369,13 @@ process_cleanup (void) {
  * 이 함수는 모든 컨텍스트 스위치에서 호출됩니다. */
 void
 process_activate (struct thread *next) {
-	/* 스레드의 페이지 테이블을 활성화합니다. */
-	pml4_activate (next->pml4);
+	/* 스레드의 페이지 테이블을 활성화합니다. 커널 스레드는 사용자 주소를
+	 * 쓰지 않고 커널 매핑은 모든 pml4에 들어 있으므로, 직전 프로세스의
+	 * 주소 공간을 그대로 빌려 써서 다시 돌아올 때 전환을 건너뜁니다.
+	 * 프로세스는 자기 pml4를 파괴하기 전에 커널 전용 pml4로 옮겨 가므로
+	 * 빌려 쓰는 동안 pml4가 사라지지는 않습니다. */
+	if (next->pml4 != NULL)
+		pml4_activate (next->pml4);
 
 	/* 인터럽트 처리에 사용할 스레드의 커널 스택을 설정합니다. */
 	tss_update (next);
@@ -410,8 +544,14 @@ load (const char *file_name, struct intr_frame *if_) {
 	success = true;
 
 done:
-	/* 로드가 성공했든 실패했든 여기에 도달합니다. */
-	file_close (file);
+	/* 로드가 성공했든 실패했든 여기에 도달합니다.
+	 * 성공하면 세그먼트를 지연 로딩할 수 있도록 실행 파일을 프로세스가
+	 * 종료될 때까지 열어 두고, 그동안 쓰기를 막습니다. */
+	if (success) {
+		file_deny_write (file);
+		t->exec_file = file;
+	} else
+		file_close (file);
 	return success;
 }
 
@@ -553,13 +693,6 @@ install_page (void *upage, void *kpage, bool writable) {
 /* 여기서부터는 프로젝트 3 이후에 사용될 코드입니다.
  * 프로젝트 2에서만 함수를 구현하려면 위의 블록에 구현하세요. */
 
-static bool
-lazy_load_segment (struct page *page, void *aux) {
-	/* TODO: 파일에서 세그먼트를 로드합니다 */
-	/* TODO: 이것은 주소 VA에서 첫 번째 페이지 폴트가 발생할 때 호출됩니다. */
-	/* TODO: 이 함수를 호출할 때 VA를 사용할 수 있습니다. */
-}
-
 /* FILE의 오프셋 OFS에서 시작하여 주소 UPAGE로 세그먼트를 로드합니다.
  * 총 READ_BYTES + ZERO_BYTES 바이트의 가상 메모리가 다음과 같이 초기화됩니다:
  *
@@ -570,31 +703,30 @@ lazy_load_segment (struct page *page, void *aux) {
  * 이 함수에 의해 초기화된 페이지는 WRITABLE이 true이면 사용자 프로세스가
  * 수정할 수 있어야 하고, 그렇지 않으면 읽기 전용이어야 합니다.
  *
- * 성공하면 true를, 메모리 할당 오류나 디스크 읽기 오류가 발생하면 false를 반환합니다. */
+ * 성공하면 true를, 메모리 할당 오류나 디스크 읽기 오류가 발생하면 false를 반환합니다.
+ *
+ * 세그먼트 전체를 VMA 하나로 등록할 뿐 페이지는 만들지 않습니다. 각 페이지는
+ * 처음 폴트가 날 때 파일에서 읽히며, BSS처럼 파일 내용이 없는 페이지는
+ * 읽기만 하는 동안 제로 프레임을 공유합니다. */
 static bool
 load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes, bool writable) {
+	struct vma *vma;
+
 	ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* 이 페이지를 채우는 방법을 계산합니다.
-		 * FILE에서 PAGE_READ_BYTES 바이트를 읽고
-		 * 마지막 PAGE_ZERO_BYTES 바이트를 0으로 채웁니다. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: lazy_load_segment에 정보를 전달하기 위해 aux를 설정합니다. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
-			return false;
-
-		/* 진행합니다. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
+	vma = vma_create (VM_ANON, upage, read_bytes + zero_bytes, writable,
+			file, ofs, read_bytes);
+	if (vma == NULL)
+		return false;
+	/* 실행 파일은 프로세스가 끝날 때까지 쓰기 금지되므로 읽기 전용
+	 * 페이지를 다른 프로세스와 함께 써도 내용이 바뀌지 않습니다. */
+	vma->shareable = !writable;
+	if (!spt_insert_vma (&thread_current ()->spt, vma)) {
+		vma_destroy (vma);
+		return false;
 	}
 	return true;
 }
@@ -604,11 +736,22 @@ static bool
 setup_stack (struct intr_frame *if_) {
 	bool success = false;
 	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
+	struct vma *stack;
+
+	/* 스택은 아래로 자라는 익명 VMA입니다. */
+	stack = vma_create (VM_ANON, stack_bottom, PGSIZE, true, NULL, 0, 0);
+	if (stack == NULL)
+		return false;
+	if (!spt_insert_vma (&thread_current ()->spt, stack)) {
+		vma_destroy (stack);
+		return false;
+	}
 
-	/* TODO: stack_bottom에 스택을 매핑하고 즉시 페이지를 요청합니다.
-	 * TODO: 성공하면 rsp를 적절히 설정합니다.
-	 * TODO: 페이지가 스택임을 표시해야 합니다. */
-	/* TODO: 여기에 코드를 작성하세요 */
+	/* 인자 전달이 곧바로 이 페이지에 쓰므로 지연시키지 않고 바로 클레임합니다. */
+	if (vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 
 	return success;
 }
@@ -1,15 +1,32 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/vaddr.h"
 #include "userprog/gdt.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
+static void sys_exit (int status) NO_RETURN;
+
+/* 파일 시스템은 스스로 동기화하지 않으므로 파일을 다루는 시스템 콜은
+ * 이 잠금을 쥐고 호출합니다. */
+static struct lock filesys_lock;
 
 /* 시스템 콜.
  *
@@ -35,23 +52,369 @@ syscall_init (void) {
 	 * 따라서 FLAG_FL을 마스크했습니다. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	lock_init (&filesys_lock);
+}
+
+/* 현재 프로세스를 종료 상태 STATUS로 끝냅니다. */
+static void
+sys_exit (int status) {
+	thread_current ()->exit_status = status;
+	thread_exit ();
+}
+
+/* 사용자 페이지 UPAGE에 접근해도 되면 true를 반환합니다. WRITE이면 쓰기도
+ * 허용되어야 합니다. */
+static bool
+user_page_ok (void *upage, bool write) {
+#ifdef VM
+	return vm_check_access (upage, write);
+#else
+	uint64_t *pte = pml4e_walk (thread_current ()->pml4, (uint64_t) upage, 0);
+	return pte != NULL && (*pte & PTE_P) && (!write || is_writable (pte));
+#endif
 }
 
+/* 사용자 주소 UADDR부터 SIZE 바이트가 모두 사용자 영역에 있고 접근할 수
+ * 있는지 검사합니다. 아니면 프로세스를 종료합니다. */
+static void
+check_buffer (const void *uaddr, size_t size, bool write) {
+	const uint8_t *start = uaddr;
+	const uint8_t *end = start + size;
+	const uint8_t *p;
+
+	if (size == 0)
+		return;
+	if (uaddr == NULL || end < start || !is_user_vaddr (end - 1))
+		sys_exit (-1);
+	for (p = pg_round_down (start); p < end; p += PGSIZE)
+		if (!user_page_ok ((void *) p, write))
+			sys_exit (-1);
+}
+
+/* 사용자 문자열 USTR 전체를 읽을 수 있는지 검사합니다. 아니면 프로세스를
+ * 종료합니다. */
+static void
+check_string (const char *ustr) {
+	const char *p = ustr;
+
+	if (ustr == NULL)
+		sys_exit (-1);
+	for (;;) {
+		if (!is_user_vaddr (p) || !user_page_ok (pg_round_down (p), false))
+			sys_exit (-1);
+		/* 페이지 끝까지는 다시 검사할 필요가 없습니다. */
+		while (*p != '\0' && pg_ofs (p + 1) != 0)
+			p++;
+		if (*p == '\0')
+			return;
+		p++;
+	}
+}
+
+static bool
+sys_create (const char *file, unsigned initial_size) {
+	bool success;
+
+	check_string (file);
+	lock_acquire (&filesys_lock);
+	success = filesys_create (file, initial_size);
+	lock_release (&filesys_lock);
+	return success;
+}
 
-int write (
-    int fd,
-    const void *buffer,
-    unsigned length
-) {
+static bool
+sys_remove (const char *file) {
+	bool success;
 
+	check_string (file);
+	lock_acquire (&filesys_lock);
+	success = filesys_remove (file);
+	lock_release (&filesys_lock);
+	return success;
 }
 
-/* 주요 시스템 콜 인터페이스 */
+static int
+sys_open (const char *name) {
+	struct file *file;
+	int fd = -1;
+
+	check_string (name);
+	lock_acquire (&filesys_lock);
+	file = filesys_open (name);
+	if (file != NULL) {
+		fd = process_add_file (file);
+		if (fd < 0)
+			file_close (file);
+	}
+	lock_release (&filesys_lock);
+	return fd;
+}
+
+static int
+sys_filesize (int fd) {
+	struct file *file = process_get_file (fd);
+	int size;
+
+	if (file == NULL)
+		return -1;
+	lock_acquire (&filesys_lock);
+	size = file_length (file);
+	lock_release (&filesys_lock);
+	return size;
+}
+
+static int
+sys_read (int fd, void *buffer, unsigned size) {
+	struct file *file;
+	struct pipe *pipe;
+	int bytes;
+
+	check_buffer (buffer, size, true);
+	if (fd == STDIN_FILENO) {
+		uint8_t *buf = buffer;
+		unsigned i;
+
+		for (i = 0; i < size; i++)
+			buf[i] = input_getc ();
+		return size;
+	}
+
+	/* 파이프는 기다릴 수 있으므로 파일 시스템 잠금 없이 다룹니다. */
+	pipe = process_get_pipe (fd, false);
+	if (pipe != NULL)
+		return pipe_read (pipe, buffer, size);
+
+	file = process_get_file (fd);
+	if (file == NULL)
+		return -1;
+	lock_acquire (&filesys_lock);
+	bytes = file_read (file, buffer, size);
+	lock_release (&filesys_lock);
+	return bytes;
+}
+
+static int
+sys_write (int fd, const void *buffer, unsigned size) {
+	struct file *file;
+	struct pipe *pipe;
+	int bytes;
+
+	check_buffer (buffer, size, false);
+	if (fd == STDOUT_FILENO) {
+		putbuf (buffer, size);
+		return size;
+	}
+
+	pipe = process_get_pipe (fd, true);
+	if (pipe != NULL)
+		return pipe_write (pipe, buffer, size);
+
+	file = process_get_file (fd);
+	if (file == NULL)
+		return -1;
+	lock_acquire (&filesys_lock);
+	bytes = file_write (file, buffer, size);
+	lock_release (&filesys_lock);
+	return bytes;
+}
+
+static void
+sys_seek (int fd, unsigned position) {
+	struct file *file = process_get_file (fd);
+
+	if (file == NULL)
+		return;
+	lock_acquire (&filesys_lock);
+	file_seek (file, position);
+	lock_release (&filesys_lock);
+}
+
+static unsigned
+sys_tell (int fd) {
+	struct file *file = process_get_file (fd);
+	unsigned position;
+
+	if (file == NULL)
+		return 0;
+	lock_acquire (&filesys_lock);
+	position = file_tell (file);
+	lock_release (&filesys_lock);
+	return position;
+}
+
+static void
+sys_close (int fd) {
+	lock_acquire (&filesys_lock);
+	process_close_fd (fd);
+	lock_release (&filesys_lock);
+}
+
+/* 파이프를 만들어 읽기 끝을 FDS[0]에, 쓰기 끝을 FDS[1]에 넣습니다. */
+static int
+sys_pipe (int *fds) {
+	struct pipe *pipe;
+
+	check_buffer (fds, 2 * sizeof *fds, true);
+	pipe = pipe_create ();
+	if (pipe == NULL)
+		return -1;
+
+	fds[0] = process_add_pipe (pipe, false);
+	if (fds[0] < 0) {
+		pipe_close (pipe, false);
+		pipe_close (pipe, true);
+		return -1;
+	}
+	fds[1] = process_add_pipe (pipe, true);
+	if (fds[1] < 0) {
+		process_close_fd (fds[0]);
+		pipe_close (pipe, true);
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef VM
+static void *
+sys_mmap (void *addr, size_t length, int writable, int fd, off_t offset,
+		int flags) {
+	struct file *file = process_get_file (fd);
+	void *mapped;
+
+	if (file == NULL || (flags & ~MAP_POPULATE) != 0)
+		return NULL;
+	lock_acquire (&filesys_lock);
+	mapped = do_mmap (addr, length, writable, file, offset);
+	if (mapped != NULL && (flags & MAP_POPULATE))
+		vm_populate (mapped, (uint8_t *) mapped + length);
+	lock_release (&filesys_lock);
+	return mapped;
+}
+
+static int
+sys_shm_open (const char *name, size_t size) {
+	check_string (name);
+	return do_shm_open (name, size);
+}
+
+/* 현재 프로세스의 자원 RESOURCE 사용 상한을 LIMIT으로 정합니다. */
+static int
+sys_setrlimit (int resource, size_t limit) {
+	if (resource != RLIMIT_RSS || limit == 0)
+		return -1;
+	vm_set_rss_limit (limit == RLIM_INFINITY ? 0 : limit);
+	return 0;
+}
+
+/* 현재 프로세스의 메모리 사용량을 ST에 채웁니다. */
+static int
+sys_memstat (struct memstat *st) {
+	struct thread *curr = thread_current ();
+
+	check_buffer (st, sizeof *st, true);
+	st->rss = curr->rss;
+	st->swap = curr->swap_cnt;
+	st->rss_limit = curr->rss_limit != 0 ? curr->rss_limit : RLIM_INFINITY;
+	return 0;
+}
+
+/* 현재 프로세스의 페이지 폴트 통계를 ST에 채웁니다. */
+static int
+sys_faultstat (struct faultstat *st) {
+	check_buffer (st, sizeof *st, true);
+	*st = thread_current ()->faults;
+	return 0;
+}
+#endif
+
+/* 주요 시스템 콜 인터페이스.
+ * 시스템 콜 번호는 RAX로, 인자는 RDI, RSI, RDX, R10, R8, R9 순서로
+ * 들어오며, 반환값은 RAX에 넣습니다. */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
-	// TODO: Your implementation goes here.
-    
+syscall_handler (struct intr_frame *f) {
+#ifdef VM
+	/* 시스템 콜 도중 사용자 스택 아래를 건드리는 폴트가 나면
+	 * 스택 확장 여부를 이 값으로 판단합니다. */
+	thread_current ()->user_rsp = f->rsp;
+#endif
 
-    printf ("system call!\n");
-	thread_exit ();
+	switch (f->R.rax) {
+		case SYS_HALT:
+			power_off ();
+		case SYS_EXIT:
+			sys_exit (f->R.rdi);
+		case SYS_CREATE:
+			f->R.rax = sys_create ((const char *) f->R.rdi, f->R.rsi);
+			break;
+		case SYS_REMOVE:
+			f->R.rax = sys_remove ((const char *) f->R.rdi);
+			break;
+		case SYS_OPEN:
+			f->R.rax = sys_open ((const char *) f->R.rdi);
+			break;
+		case SYS_FILESIZE:
+			f->R.rax = sys_filesize (f->R.rdi);
+			break;
+		case SYS_READ:
+			f->R.rax = sys_read (f->R.rdi, (void *) f->R.rsi, f->R.rdx);
+			break;
+		case SYS_WRITE:
+			f->R.rax = sys_write (f->R.rdi, (const void *) f->R.rsi, f->R.rdx);
+			break;
+		case SYS_SEEK:
+			sys_seek (f->R.rdi, f->R.rsi);
+			break;
+		case SYS_TELL:
+			f->R.rax = sys_tell (f->R.rdi);
+			break;
+		case SYS_CLOSE:
+			sys_close (f->R.rdi);
+			break;
+		case SYS_PIPE:
+			f->R.rax = sys_pipe ((int *) f->R.rdi);
+			break;
+#ifdef VM
+		case SYS_MMAP:
+			f->R.rax = (uint64_t) sys_mmap ((void *) f->R.rdi, f->R.rsi,
+					f->R.rdx, f->R.r10, f->R.r8, f->R.r9);
+			break;
+		case SYS_MUNMAP:
+			lock_acquire (&filesys_lock);
+			do_munmap ((void *) f->R.rdi);
+			lock_release (&filesys_lock);
+			break;
+		case SYS_MADVISE:
+			lock_acquire (&filesys_lock);
+			f->R.rax = do_madvise ((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+			lock_release (&filesys_lock);
+			break;
+		case SYS_MSYNC:
+			lock_acquire (&filesys_lock);
+			f->R.rax = do_msync ((void *) f->R.rdi, f->R.rsi);
+			lock_release (&filesys_lock);
+			break;
+		case SYS_SHM_OPEN:
+			f->R.rax = sys_shm_open ((const char *) f->R.rdi, f->R.rsi);
+			break;
+		case SYS_SHM_MAP:
+			f->R.rax = (uint64_t) do_shm_map (f->R.rdi, (void *) f->R.rsi);
+			break;
+		case SYS_SHM_UNMAP:
+			f->R.rax = do_shm_unmap ((void *) f->R.rdi);
+			break;
+		case SYS_SETRLIMIT:
+			f->R.rax = sys_setrlimit (f->R.rdi, f->R.rsi);
+			break;
+		case SYS_MEMSTAT:
+			f->R.rax = sys_memstat ((struct memstat *) f->R.rdi);
+			break;
+		case SYS_FAULTSTAT:
+			f->R.rax = sys_faultstat ((struct faultstat *) f->R.rdi);
+			break;
+#endif
+		default:
+			/* 아직 지원하지 않는 시스템 콜입니다. */
+			sys_exit (-1);
+	}
 }
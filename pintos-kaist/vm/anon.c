@@ -2,6 +2,14 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include <bitmap.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* 한 페이지를 담는 스왑 슬롯의 섹터 수 */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
 
 /* 아래 줄을 수정하지 마세요 */
 static struct disk *swap_disk;
@@ -9,6 +17,13 @@ static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
 
+/* 스왑 슬롯.
+ * KSM이 합친 프레임을 내보내면 그 프레임을 쓰던 모든 페이지가 한 슬롯을
+ * 함께 가리키므로, 슬롯마다 참조 카운트를 둡니다. */
+static struct bitmap *swap_map;     /* 사용 중인 슬롯 */
+static unsigned *swap_refs;         /* 슬롯별 참조 카운트 */
+static struct lock swap_lock;       /* SWAP_MAP과 SWAP_REFS 보호 */
+
 /* 이 구조체를 수정하지 마세요 */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -20,8 +35,16 @@ static const struct page_operations anon_ops = {
 /* 익명 페이지의 데이터를 초기화합니다 */
 void
 vm_anon_init (void) {
-	/* TODO: swap_disk를 설정하세요. */
-	swap_disk = NULL;
+	size_t slot_cnt;
+
+	swap_disk = disk_get (1, 1);
+	lock_init (&swap_lock);
+
+	slot_cnt = swap_disk != NULL ? disk_size (swap_disk) / SECTORS_PER_SLOT : 0;
+	swap_map = bitmap_create (slot_cnt);
+	swap_refs = calloc (slot_cnt, sizeof *swap_refs);
+	if (swap_map == NULL || (slot_cnt > 0 && swap_refs == NULL))
+		PANIC ("swap table allocation failed");
 }
 
 /* 파일 매핑을 초기화합니다 */
@@ -31,22 +54,102 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->slot = BITMAP_ERROR;
+	return true;
+}
+
+/* 슬롯 SLOT의 참조 하나를 놓고, 마지막이었다면 슬롯을 비웁니다. */
+void
+swap_slot_put (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (swap_refs[slot] > 0);
+	if (--swap_refs[slot] == 0)
+		bitmap_reset (swap_map, slot);
+	lock_release (&swap_lock);
+}
+
+/* 슬롯 SLOT의 내용을 KVA로 읽습니다. 슬롯의 참조는 그대로 둡니다. */
+void
+swap_read (size_t slot, void *kva) {
+	size_t i;
+
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_read (swap_disk, slot * SECTORS_PER_SLOT + i,
+				(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+}
+
+/* 축출 중인 FRAME의 내용을 스왑 슬롯에 쓰고 그 슬롯의 참조 하나를 얻어
+ * 슬롯 번호를 반환합니다. 같은 축출에서 이미 썼다면 참조만 늘립니다.
+ * 빈 슬롯이 없으면 BITMAP_ERROR를 반환합니다. */
+size_t
+swap_write (struct frame *frame) {
+	size_t i;
+
+	if (frame->swap_slot == BITMAP_ERROR) {
+		size_t slot;
+
+		lock_acquire (&swap_lock);
+		slot = bitmap_scan_and_flip (swap_map, 0, 1, false);
+		lock_release (&swap_lock);
+		if (slot == BITMAP_ERROR)
+			return BITMAP_ERROR;
+
+		for (i = 0; i < SECTORS_PER_SLOT; i++)
+			disk_write (swap_disk, slot * SECTORS_PER_SLOT + i,
+					(uint8_t *) frame->kva + i * DISK_SECTOR_SIZE);
+		frame->swap_slot = slot;
+	}
+
+	lock_acquire (&swap_lock);
+	swap_refs[frame->swap_slot]++;
+	lock_release (&swap_lock);
+	return frame->swap_slot;
 }
 
 /* 스왑 디스크에서 내용을 읽어 페이지를 스왑 인합니다. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* 스왑에 쓰지 않고 버린 읽기 전용 파일 내용은 파일에서 다시 읽습니다. */
+	if (anon_page->slot == BITMAP_ERROR)
+		return vma_load_page (page, NULL);
+
+	swap_read (anon_page->slot, kva);
+	swap_slot_put (anon_page->slot);
+	anon_page->slot = BITMAP_ERROR;
+	vm_add_swap (page->owner, -1);
+	return true;
 }
 
-/* 스왑 디스크에 내용을 써서 페이지를 스왑 아웃합니다. */
+/* 스왑 디스크에 내용을 써서 페이지를 스왑 아웃합니다.
+ * 같은 프레임을 쓰는 페이지들 중 처음 불린 페이지만 실제로 쓰고,
+ * 나머지는 그 슬롯의 참조만 늘립니다. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* 읽기 전용 파일 내용은 언제든 파일에서 다시 읽을 수 있습니다. */
+	if (!page->writable && page->vma != NULL
+			&& vma_has_file_data (page->vma, page->va))
+		return true;
+
+	anon_page->slot = swap_write (page->frame);
+	if (anon_page->slot == BITMAP_ERROR)
+		return false;
+	vm_add_swap (page->owner, 1);
+	return true;
 }
 
 /* 익명 페이지를 파괴합니다. PAGE는 호출자에 의해 해제됩니다. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* 축출 중이었다면 끝나기를 기다린 뒤에 슬롯을 봐야 합니다. */
+	vm_release_frame (page);
+	if (anon_page->slot != BITMAP_ERROR) {
+		swap_slot_put (anon_page->slot);
+		vm_add_swap (page->owner, -1);
+	}
 }
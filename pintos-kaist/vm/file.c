@@ -1,10 +1,35 @@
 /* file.c: 메모리 백업 파일 객체(mmap된 객체)의 구현. */
 
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 
+/* 라이트백할 때 파일 오프셋이 이어지는 페이지를 한 번의 쓰기로 모을
+ * 최대 페이지 수 */
+#define WB_BATCH_PAGES 16
+
+/* 파일 오프셋이 이어지는 더러운 페이지들을 모아 두는 버퍼 */
+struct wb_batch {
+	struct vma *vma;            /* 페이지들이 속한 VMA */
+	uint8_t *buf;               /* WB_BATCH_PAGES 페이지 크기의 버퍼 */
+	void *start;                /* 모은 첫 페이지의 주소 */
+	size_t cnt;                 /* 모은 페이지 수 */
+	size_t bytes;               /* 파일에 쓸 바이트 수 */
+};
+
+/* 통계 */
+static long long wb_page_cnt;   /* 파일에 다시 쓴 페이지 수 */
+static long long wb_write_cnt;  /* 그 때 호출한 file_write_at() 수 */
+
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
 static void file_backed_destroy (struct page *page);
+static void file_backed_write_back (struct page *page);
 
 /* 이 구조체를 수정하지 마세요 */
 static const struct page_operations file_ops = {
@@ -25,34 +50,286 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	/* 핸들러를 설정합니다 */
 	page->operations = &file_ops;
 
-	struct file_page *file_page = &page->file;
+	struct file_page *file_page UNUSED = &page->file;
+	return true;
 }
 
-/* 파일에서 내용을 읽어 페이지를 스왑 인합니다. */
+/* 파일에서 내용을 읽어 페이지를 스왑 인합니다. 파일 끝 너머에 있어
+ * 처음 폴트 때 0으로 채웠던 페이지는 다시 0으로 채웁니다. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page UNUSED = &page->file;
+
+	if (!vma_has_file_data (page->vma, page->va)) {
+		memset (kva, 0, PGSIZE);
+		return true;
+	}
+	return vma_load_page (page, NULL);
 }
 
 /* 파일에 내용을 라이트백하여 페이지를 스왑 아웃합니다. */
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+
+	file_backed_write_back (page);
+	return true;
 }
 
 /* 파일 백업 페이지를 파괴합니다. PAGE는 호출자에 의해 해제됩니다. */
 static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+
+	/* 라이트백하는 동안 프레임이 축출되지 않도록 고정합니다. */
+	if (vm_pin_frame (page)) {
+		file_backed_write_back (page);
+		vm_unpin_frame (page);
+	}
+	vm_release_frame (page);
+}
+
+/* PAGE가 프레임을 가지고 있고, 사용자가 쓴 적이 있고, 파일에서 온
+ * 내용을 담고 있으면 true를 반환합니다. */
+static bool
+file_backed_is_dirty (struct page *page) {
+	return page->frame != NULL
+		&& pml4_is_dirty (page->owner->pml4, page->va)
+		&& vma_has_file_data (page->vma, page->va);
+}
+
+/* PAGE 중 파일에서 온 부분의 바이트 수를 반환합니다. 파일 끝 너머의
+ * 0으로 채운 부분은 파일에 쓰지 않습니다. */
+static size_t
+file_backed_bytes (struct page *page) {
+	size_t page_ofs = (uint8_t *) page->va - (uint8_t *) page->vma->start;
+	size_t bytes = page->vma->read_bytes - page_ofs;
+
+	return bytes < PGSIZE ? bytes : PGSIZE;
+}
+
+/* PAGE가 더러우면 파일에서 온 부분만 파일에 다시 씁니다. 쓰는 도중의
+ * 사용자 쓰기를 잃지 않도록 쓰기 전에 더티 비트를 지웁니다. */
+static void
+file_backed_write_back (struct page *page) {
+	struct vma *vma = page->vma;
+
+	if (!file_backed_is_dirty (page))
+		return;
+
+	pml4_set_dirty (page->owner->pml4, page->va, false);
+	file_write_at (vma->file, page->frame->kva, file_backed_bytes (page),
+			vma->ofs + ((uint8_t *) page->va - (uint8_t *) vma->start));
+	wb_page_cnt++;
+	wb_write_cnt++;
+}
+
+/* BATCH에 모인 페이지들을 한 번의 쓰기로 파일에 씁니다. 버퍼가 페이지
+ * 단위로 이어져 있으므로 아이노드는 섹터 전체를 바운스 버퍼 없이 바로
+ * 씁니다. */
+static void
+wb_batch_flush (struct wb_batch *batch) {
+	struct vma *vma = batch->vma;
+
+	if (batch->cnt == 0)
+		return;
+
+	file_write_at (vma->file, batch->buf, batch->bytes,
+			vma->ofs + ((uint8_t *) batch->start - (uint8_t *) vma->start));
+	wb_page_cnt += batch->cnt;
+	wb_write_cnt++;
+	batch->cnt = 0;
+	batch->bytes = 0;
+}
+
+/* 고정된 더러운 PAGE의 내용을 BATCH에 덧붙입니다. PAGE가 앞서 모은
+ * 페이지들과 이어지지 않거나 BATCH가 가득 찼으면 먼저 비웁니다. */
+static void
+wb_batch_add (struct wb_batch *batch, struct page *page) {
+	size_t bytes = file_backed_bytes (page);
+
+	if (batch->cnt > 0 && (batch->cnt == WB_BATCH_PAGES
+				|| page->va != (uint8_t *) batch->start + batch->cnt * PGSIZE))
+		wb_batch_flush (batch);
+	if (batch->cnt == 0)
+		batch->start = page->va;
+
+	/* 복사한 뒤의 쓰기는 더티 비트를 다시 켜서 다음 라이트백이 씁니다. */
+	pml4_set_dirty (page->owner->pml4, page->va, false);
+	memcpy (batch->buf + batch->cnt * PGSIZE, page->frame->kva, bytes);
+	batch->cnt++;
+	batch->bytes += bytes;
 }
 
-/* mmap을 수행합니다 */
+static bool
+page_va_less (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct page, vma_elem)->va
+		< list_entry (b, struct page, vma_elem)->va;
+}
+
+/* 파일 매핑 VMA의 [START, END) 안에서 더러운 페이지만 파일에 다시 씁니다.
+ * 페이지를 주소, 곧 파일 오프셋 순서로 훑으면서 이어지는 더러운 페이지를
+ * 최대 WB_BATCH_PAGES개씩 모아 한 번에 씁니다. 깨끗한 페이지와 프레임이
+ * 없는 페이지는 I/O 없이 건너뜁니다. 모음 버퍼를 얻지 못하면 한 페이지씩
+ * 씁니다. */
+void
+file_backed_flush (struct vma *vma, void *start, void *end) {
+	struct wb_batch batch = { .vma = vma };
+	struct list_elem *e;
+
+	ASSERT (VM_TYPE (vma->type) == VM_FILE);
+
+	if (!vma->writable)
+		return;
+
+	batch.buf = palloc_get_multiple (0, WB_BATCH_PAGES);
+	list_sort (&vma->pages, page_va_less, NULL);
+	for (e = list_begin (&vma->pages); e != list_end (&vma->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, vma_elem);
+
+		if (page->va < start)
+			continue;
+		if (page->va >= end)
+			break;
+
+		/* 복사나 쓰기 도중 축출되지 않도록 고정합니다. */
+		if (!vm_pin_frame (page))
+			continue;
+		if (batch.buf == NULL)
+			file_backed_write_back (page);
+		else if (file_backed_is_dirty (page))
+			wb_batch_add (&batch, page);
+		vm_unpin_frame (page);
+	}
+	wb_batch_flush (&batch);
+	palloc_free_multiple (batch.buf, WB_BATCH_PAGES);
+}
+
+/* 파일 매핑 라이트백 통계를 출력합니다. */
+void
+vm_file_print_stats (void) {
+	printf ("File mappings: %lld pages written back in %lld writes\n",
+			wb_page_cnt, wb_write_cnt);
+}
+
+/* mmap을 수행합니다.
+ * FILE의 OFFSET부터 LENGTH 바이트를 ADDR에 매핑하는 VMA 하나를 등록하고
+ * ADDR을 반환합니다. 페이지는 접근할 때 만들어지므로 매핑 크기와 상관없이
+ * 상수 시간에 끝납니다. 인자가 잘못되었거나 기존 매핑과 겹치면 NULL을
+ * 반환합니다. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct vma *vma;
+	off_t file_len;
+	size_t read_bytes;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+			|| offset < 0 || offset % PGSIZE != 0)
+		return NULL;
+	if (!is_user_vaddr (addr)
+			|| (uint64_t) addr + length < (uint64_t) addr
+			|| !is_user_vaddr ((uint8_t *) addr + length - 1))
+		return NULL;
+
+	file_len = file_length (file);
+	if (file_len == 0)
+		return NULL;
+	read_bytes = offset < file_len ? (size_t) (file_len - offset) : 0;
+	if (read_bytes > length)
+		read_bytes = length;
+
+	vma = vma_create (VM_FILE, addr, length, writable != 0, file, offset,
+			read_bytes);
+	if (vma == NULL)
+		return NULL;
+	if (!spt_insert_vma (&thread_current ()->spt, vma)) {
+		vma_destroy (vma);
+		return NULL;
+	}
+	return addr;
 }
 
-/* munmap을 수행합니다 */
+/* munmap을 수행합니다.
+ * ADDR에서 시작하는 파일 매핑을 통째로 제거합니다. 쓰인 페이지는 제거되기
+ * 전에 file_backed_flush()로 모아서 파일에 다시 쓰입니다. */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma = vma_tree_find (&spt->vmas, addr);
+
+	if (vma != NULL && vma->start == addr && VM_TYPE (vma->type) == VM_FILE)
+		spt_remove_vma (spt, vma);
+}
+
+/* msync를 수행합니다.
+ * [ADDR, ADDR + LENGTH)가 걸친 파일 매핑의 더러운 페이지를 지금 파일에
+ * 다시 씁니다. 익명 매핑은 건너뜁니다. 구간 안에 매핑되지 않은 곳이
+ * 있거나 인자가 잘못되었으면 -1을, 아니면 0을 반환합니다. */
+int
+do_msync (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va = addr;
+	uint8_t *end = va + ROUND_UP (length, PGSIZE);
+
+	if (pg_ofs (addr) != 0 || end < va || !is_user_vaddr (addr)
+			|| (end > va && !is_user_vaddr (end - 1)))
+		return -1;
+
+	while (va < end) {
+		struct vma *vma = vma_tree_find (&spt->vmas, va);
+		uint8_t *stop;
+
+		if (vma == NULL)
+			return -1;
+		stop = end < (uint8_t *) vma->end ? end : vma->end;
+		if (VM_TYPE (vma->type) == VM_FILE)
+			file_backed_flush (vma, va, stop);
+		va = stop;
+	}
+	return 0;
+}
+
+/* madvise를 수행합니다.
+ * [ADDR, ADDR + LENGTH)가 걸친 매핑들에 ADVICE를 적용합니다.
+ * MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL은 구간이 걸친 VMA 전체의 접근
+ * 방식을 바꾸고, MADV_WILLNEED와 MADV_DONTNEED는 구간 안의 페이지만
+ * 미리 읽거나 버립니다. 구간 안에 매핑되지 않은 곳이 있거나 인자가
+ * 잘못되었으면 -1을, 아니면 0을 반환합니다. */
+int
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va = addr;
+	uint8_t *end = va + ROUND_UP (length, PGSIZE);
+
+	if (pg_ofs (addr) != 0 || end < va || !is_user_vaddr (addr)
+			|| (end > va && !is_user_vaddr (end - 1)))
+		return -1;
+	if (advice < MADV_NORMAL || advice > MADV_DONTNEED)
+		return -1;
+
+	while (va < end) {
+		struct vma *vma = vma_tree_find (&spt->vmas, va);
+		uint8_t *stop;
+
+		if (vma == NULL)
+			return -1;
+		stop = end < (uint8_t *) vma->end ? end : vma->end;
+
+		switch (advice) {
+			case MADV_WILLNEED:
+				vm_populate (va, stop);
+				break;
+			case MADV_DONTNEED:
+				vm_discard (va, stop);
+				break;
+			default:
+				vma->advice = advice;
+				break;
+		}
+		va = stop;
+	}
+	return 0;
 }
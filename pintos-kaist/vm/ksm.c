@@ -0,0 +1,217 @@
+/* ksm.c: 같은 내용의 익명 페이지 병합 (Kernel Samepage Merging).
+ *
+ * 낮은 우선순위의 커널 스레드가 프레임 테이블을 돌면서 한 프로세스만
+ * 쓰는 익명 프레임의 내용을 해시합니다. 두 번 연달아 같은 해시가 나온
+ * 프레임만 후보로 삼아 자주 바뀌는 페이지는 건너뜁니다.
+ *
+ * - 안정 테이블: 이미 합쳐진 읽기 전용 프레임. 내용 해시가 키입니다.
+ * - 불안정 테이블: 이번 회차에 본 후보 프레임. 회차가 끝나면 비웁니다.
+ *
+ * 후보가 안정 테이블의 프레임과 같으면 그 프레임을 함께 쓰도록 옮기고,
+ * 불안정 테이블의 프레임과 같으면 그 프레임을 안정 테이블로 올린 뒤
+ * 옮깁니다. 합쳐진 페이지는 읽기 전용으로 매핑되므로 쓰기가 일어나면
+ * vm_handle_wp()가 쓰기 시 복사로 공유를 깹니다.
+ *
+ * 비교하기 전에 양쪽 페이지를 먼저 쓰기 금지하므로, 해시를 계산한 뒤에
+ * 내용이 바뀌었더라도 잘못 합치는 일은 없습니다. */
+
+#include "vm/ksm.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* 한 번 훑은 뒤 쉬는 시간 (밀리초) */
+#define KSM_SLEEP_MS 20
+
+/* 한 번 깨어날 때마다 훑을 프레임 수. 기본값 0은 KSM을 끈 상태이며,
+ * 커널 명령줄 옵션 "-ksm=N"으로 켭니다. */
+size_t ksm_pages_to_scan = 0;
+
+static struct hash stable;      /* 합쳐진 프레임 */
+static struct hash unstable;    /* 이번 회차의 후보 프레임 */
+static size_t scan_hand;        /* 다음에 훑을 프레임 테이블 위치 */
+
+/* 통계 */
+static long long merge_cnt;     /* 다른 프레임으로 합쳐진 페이지 수 */
+static long long unmerge_cnt;   /* 쓰기로 공유가 깨진 페이지 수 */
+
+static void ksmd (void *aux);
+static void ksm_scan_frame (struct frame *frame);
+
+static uint64_t
+frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct frame, ksm_elem)->checksum;
+}
+
+static bool
+frame_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct frame, ksm_elem)->checksum
+		< hash_entry (b, struct frame, ksm_elem)->checksum;
+}
+
+/* KSM을 초기화하고, 켜져 있으면 ksmd 스레드를 시작합니다. */
+void
+ksm_init (void) {
+	hash_init (&stable, frame_hash, frame_less, NULL);
+	hash_init (&unstable, frame_hash, frame_less, NULL);
+
+	if (ksm_pages_to_scan > 0)
+		thread_create ("ksmd", PRI_MIN, ksmd, NULL);
+}
+
+/* 해제되는 FRAME을 KSM 테이블에서 뺍니다. FRAME_LOCK을 쥐고 호출합니다. */
+void
+ksm_frame_freed (struct frame *frame) {
+	if (frame->merged)
+		hash_delete (&stable, &frame->ksm_elem);
+	else if (frame->unstable)
+		hash_delete (&unstable, &frame->ksm_elem);
+	frame->merged = frame->unstable = false;
+}
+
+/* 합쳐진 FRAME을 쓰는 페이지 하나가 쓰기로 공유를 깼음을 기록합니다.
+ * 그 페이지가 마지막 사용자라면 FRAME은 다시 한 페이지만의 프레임이
+ * 됩니다. FRAME_LOCK을 쥐고 호출합니다. */
+void
+ksm_unmerge (struct frame *frame) {
+	if (!frame->merged)
+		return;
+
+	unmerge_cnt++;
+	if (frame->ref_cnt == 1) {
+		hash_delete (&stable, &frame->ksm_elem);
+		frame->merged = false;
+	}
+}
+
+/* KSM 통계를 출력합니다. */
+void
+ksm_print_stats (void) {
+	printf ("KSM: %lld pages merged, %lld unmerged, %zu shared frames\n",
+			merge_cnt, unmerge_cnt, hash_size (&stable));
+}
+
+/* TABLE에서 해시가 CHECKSUM인 프레임을 찾습니다. */
+static struct frame *
+ksm_lookup (struct hash *table, uint64_t checksum) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.checksum = checksum;
+	e = hash_find (table, &key.ksm_elem);
+	return e != NULL ? hash_entry (e, struct frame, ksm_elem) : NULL;
+}
+
+/* 불안정 테이블의 원소 E를 비울 때 호출됩니다. */
+static void
+unstable_clear (struct hash_elem *e, void *aux UNUSED) {
+	hash_entry (e, struct frame, ksm_elem)->unstable = false;
+}
+
+/* FRAME의 유일한 페이지를 내용이 같은 TARGET으로 옮기고 FRAME을
+ * 해제합니다. TARGET이 아직 후보라면 안정 테이블로 올립니다. 내용이
+ * 다르면 아무것도 바꾸지 않고 false를 반환합니다. */
+static bool
+ksm_merge (struct frame *frame, struct frame *target) {
+	struct page *page = frame->page;
+	struct page *target_page = target->page;
+
+	/* 비교하는 동안 어느 쪽도 바뀌지 않도록 먼저 쓰기 금지합니다. 그
+	 * 사이의 쓰기는 vm_handle_wp()에서 FRAME_LOCK을 기다립니다. */
+	vm_page_set_writable (page, false);
+	if (!target->merged)
+		vm_page_set_writable (target_page, false);
+
+	if (memcmp (frame->kva, target->kva, PGSIZE)) {
+		vm_page_set_writable (page, page->writable);
+		if (!target->merged)
+			vm_page_set_writable (target_page, target_page->writable);
+		return false;
+	}
+
+	if (!target->merged) {
+		hash_delete (&unstable, &target->ksm_elem);
+		target->unstable = false;
+		target->merged = true;
+		hash_insert (&stable, &target->ksm_elem);
+	}
+
+	vm_frame_unlink (page);
+	vm_frame_link (target, page, false);
+	merge_cnt++;
+	return true;
+}
+
+/* 프레임 하나를 훑습니다. FRAME_LOCK을 쥐고 호출합니다. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct frame *match;
+	uint64_t checksum;
+
+	/* 한 페이지만 쓰는 익명 프레임만 후보가 됩니다. 공유 페이지 캐시의
+	 * 프레임은 이미 공유되고 있고, 공유 메모리 세그먼트의 프레임은 쓰기
+	 * 가능하게 공유되어야 하므로 건너뜁니다. */
+	if (frame->merged || frame->ref_cnt != 1 || frame->inode != NULL
+			|| frame->shm != NULL || frame->pin_cnt > 0 || frame->evicting
+			|| frame->page->operations->type != VM_ANON)
+		return;
+
+	/* 직전에 본 내용과 다르면 자주 바뀌는 페이지로 보고 다음 회차로
+	 * 미룹니다. 해시는 테이블의 키이므로 바꾸기 전에 테이블에서 뺍니다. */
+	checksum = hash_bytes (frame->kva, PGSIZE);
+	if (checksum != frame->checksum) {
+		ksm_frame_freed (frame);
+		frame->checksum = checksum;
+		return;
+	}
+
+	match = ksm_lookup (&stable, checksum);
+	if (match != NULL) {
+		ksm_merge (frame, match);
+		return;
+	}
+
+	if (frame->unstable)
+		return;
+	match = ksm_lookup (&unstable, checksum);
+	if (match == NULL) {
+		frame->unstable = true;
+		hash_insert (&unstable, &frame->ksm_elem);
+	} else
+		ksm_merge (frame, match);
+}
+
+/* ksmd 스레드.
+ * 프레임 테이블을 앞에서부터 차례로 훑습니다. 한 번 깨어날 때
+ * KSM_PAGES_TO_SCAN개의 사용 중인 프레임까지만 훑고 KSM_SLEEP_MS 동안
+ * 쉬어 CPU를 너무 많이 쓰지 않게 합니다. 테이블 끝에 닿으면 한 회차가
+ * 끝나고 불안정 테이블을 비웁니다. */
+static void
+ksmd (void *aux UNUSED) {
+	for (;;) {
+		size_t scanned = 0, i;
+
+		for (i = 0; i < frame_cnt && scanned < ksm_pages_to_scan; i++) {
+			struct frame *frame = &frame_table[scan_hand];
+
+			lock_acquire (&frame_lock);
+			if (frame->in_use) {
+				ksm_scan_frame (frame);
+				scanned++;
+			}
+			if (++scan_hand >= frame_cnt) {
+				hash_clear (&unstable, unstable_clear);
+				scan_hand = 0;
+			}
+			lock_release (&frame_lock);
+		}
+		timer_msleep (KSM_SLEEP_MS);
+	}
+}
@@ -0,0 +1,94 @@
+/* kswapd.c: 백그라운드 페이지 회수 스레드.
+ *
+ * 축출을 폴트 경로에서만 하면 폴트를 낸 프로세스가 더티 희생 페이지를
+ * 내보내는 비용까지 치러야 합니다. kswapd는 사용자 풀에 남은 프레임이
+ * 낮은 워터마크 아래로 내려가면 깨어나, 높은 워터마크에 이를 때까지
+ * 프레임을 묶음으로 축출해 풀에 돌려줍니다. 그래서 보통의 폴트는 바로
+ * 빈 프레임을 얻습니다. */
+
+#include "vm/kswapd.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* 한 묶음에 축출할 프레임 수 */
+#define KSWAPD_BATCH 16
+
+/* 낮은 워터마크 (프레임). 기본값 0은 kswapd를 끈 상태이며, 커널
+ * 명령줄 옵션 "-kswapd=N"으로 켭니다. */
+size_t kswapd_low_wmark = 0;
+
+static struct semaphore wakeup;     /* kswapd를 깨웁니다 */
+static bool running;                /* kswapd가 회수하는 중, 인터럽트를
+                                       끄고 읽고 씁니다 */
+
+/* 통계 */
+static long long wakeup_cnt;        /* 깨어난 횟수 */
+static long long reclaim_cnt;       /* 회수한 프레임 수 */
+
+static void kswapd (void *aux);
+
+/* kswapd를 초기화하고, 켜져 있으면 스레드를 시작합니다. */
+void
+kswapd_init (void) {
+	sema_init (&wakeup, 0);
+	if (kswapd_low_wmark > 0)
+		thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL);
+}
+
+/* 남은 프레임 수가 FREE_FRAMES일 때 호출합니다. 낮은 워터마크 아래라면
+ * kswapd를 깨웁니다. */
+void
+kswapd_poke (size_t free_frames) {
+	enum intr_level old_level;
+	bool wake;
+
+	if (kswapd_low_wmark == 0 || free_frames >= kswapd_low_wmark)
+		return;
+
+	old_level = intr_disable ();
+	wake = !running;
+	running = true;
+	intr_set_level (old_level);
+
+	if (wake)
+		sema_up (&wakeup);
+}
+
+/* kswapd 통계를 출력합니다. */
+void
+kswapd_print_stats (void) {
+	printf ("kswapd: woken %lld times, reclaimed %lld frames\n",
+			wakeup_cnt, reclaim_cnt);
+}
+
+/* kswapd 스레드. */
+static void
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		enum intr_level old_level;
+
+		sema_down (&wakeup);
+		wakeup_cnt++;
+
+		while (vm_free_frames () < 2 * kswapd_low_wmark) {
+			size_t i;
+
+			for (i = 0; i < KSWAPD_BATCH; i++)
+				if (!vm_reclaim ())
+					break;
+			reclaim_cnt += i;
+
+			/* 더 축출할 프레임이 없습니다. */
+			if (i < KSWAPD_BATCH)
+				break;
+		}
+
+		old_level = intr_disable ();
+		running = false;
+		intr_set_level (old_level);
+	}
+}
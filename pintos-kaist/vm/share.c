@@ -0,0 +1,96 @@
+/* share.c: 읽기 전용 파일 페이지의 공유 페이지 캐시.
+ *
+ * 같은 실행 파일을 여러 프로세스가 실행하면 코드 세그먼트처럼 쓰기가
+ * 금지된 세그먼트의 내용은 모두 같습니다. 이런 페이지는 (아이노드, 파일
+ * 오프셋, 읽을 바이트 수)를 키로 하는 이 캐시에서 프레임을 찾아 모든
+ * 프로세스가 읽기 전용으로 함께 매핑합니다. 프레임은 역매핑의 참조
+ * 카운트가 0이 되어 해제될 때 캐시에서도 빠집니다.
+ *
+ * 모든 함수는 FRAME_LOCK을 쥐고 호출해야 합니다. */
+
+#include "vm/share.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include "vm/vm.h"
+
+static struct hash cache;       /* 공유 중인 프레임 */
+
+/* 통계 */
+static long long hit_cnt;       /* 캐시에서 프레임을 찾은 횟수 */
+static long long miss_cnt;      /* 파일에서 새로 읽어 등록한 횟수 */
+
+static uint64_t
+frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, share_elem);
+	uint64_t key[3] = { (uint64_t) f->inode, f->ofs, f->read_bytes };
+
+	return hash_bytes (key, sizeof key);
+}
+
+static bool
+frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, share_elem);
+	const struct frame *b = hash_entry (b_, struct frame, share_elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* 공유 페이지 캐시를 초기화합니다. */
+void
+share_init (void) {
+	hash_init (&cache, frame_hash, frame_less, NULL);
+}
+
+/* INODE의 OFS부터 READ_BYTES를 읽고 나머지를 0으로 채운 내용을 가진
+ * 공유 프레임을 찾습니다. 없으면 NULL을 반환합니다. */
+struct frame *
+share_lookup (struct inode *inode, off_t ofs, size_t read_bytes) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.inode = inode;
+	key.ofs = ofs;
+	key.read_bytes = read_bytes;
+	e = hash_find (&cache, &key.share_elem);
+	if (e == NULL)
+		return NULL;
+	hit_cnt++;
+	return hash_entry (e, struct frame, share_elem);
+}
+
+/* 방금 파일에서 읽어 온 FRAME을 INODE, OFS, READ_BYTES의 공유 프레임으로
+ * 등록합니다. 같은 키의 프레임이 이미 없어야 합니다. */
+void
+share_insert (struct frame *frame, struct inode *inode, off_t ofs,
+		size_t read_bytes) {
+	ASSERT (frame->inode == NULL);
+
+	frame->inode = inode;
+	frame->ofs = ofs;
+	frame->read_bytes = read_bytes;
+	hash_insert (&cache, &frame->share_elem);
+	miss_cnt++;
+}
+
+/* 해제되는 FRAME이 공유 프레임이면 캐시에서 뺍니다. */
+void
+share_remove (struct frame *frame) {
+	if (frame->inode == NULL)
+		return;
+
+	hash_delete (&cache, &frame->share_elem);
+	frame->inode = NULL;
+}
+
+/* 공유 페이지 캐시 통계를 출력합니다. */
+void
+share_print_stats (void) {
+	printf ("Shared text: %lld hits, %lld misses, %zu frames\n",
+			hit_cnt, miss_cnt, hash_size (&cache));
+}
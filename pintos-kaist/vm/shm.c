@@ -0,0 +1,362 @@
+/* shm.c: 프로세스 사이의 공유 메모리 세그먼트.
+ *
+ * shm_open()이 이름으로 세그먼트를 만들거나 찾고, shm_map()이 세그먼트
+ * 전체를 현재 프로세스의 주소 공간에 VMA 하나로 매핑합니다. 폴트가 나면
+ * 세그먼트의 같은 페이지가 이미 올라와 있는 프레임을 역매핑에 더해
+ * 함께 쓰므로, 한 프로세스가 쓴 내용을 다른 프로세스가 바로 봅니다.
+ *
+ * 세그먼트의 프레임도 다른 익명 메모리처럼 축출됩니다. 내용은 스왑
+ * 슬롯에 쓰이고 세그먼트가 그 슬롯을 기억해 두었다가, 어느 프로세스든
+ * 다음에 폴트를 내면 다시 읽어 들입니다. 프레임의 마지막 사용자가
+ * 매핑을 없앨 때 스왑이 가득 차 있으면 내용은 세그먼트가 가진 커널
+ * 페이지로 옮겨 둡니다.
+ *
+ * 세그먼트는 그것을 매핑한 VMA와 그것을 연 프로세스를 참조로 셉니다.
+ * 연 프로세스의 참조는 그 프로세스가 끝날 때 놓입니다. 마지막 참조가
+ * 사라지면 스왑 슬롯과 함께 해제되며, 이름도 다시 쓸 수 있게 됩니다. */
+
+#include "vm/shm.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_ANON,
+};
+
+static struct list segments;    /* 살아 있는 세그먼트 */
+static struct lock shm_lock;    /* SEGMENTS와 각 세그먼트의 REF_CNT 보호 */
+static int next_id;             /* 다음 세그먼트 식별자 */
+
+/* 공유 메모리를 초기화합니다. */
+void
+shm_init (void) {
+	list_init (&segments);
+	lock_init (&shm_lock);
+}
+
+/* 식별자가 ID인 세그먼트를 찾습니다. SHM_LOCK을 쥐고 호출합니다. */
+static struct shm_segment *
+shm_find_id (int id) {
+	struct list_elem *e;
+
+	for (e = list_begin (&segments); e != list_end (&segments);
+			e = list_next (e)) {
+		struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+		if (seg->id == id)
+			return seg;
+	}
+	return NULL;
+}
+
+/* 이름이 NAME인 세그먼트를 찾습니다. SHM_LOCK을 쥐고 호출합니다. */
+static struct shm_segment *
+shm_find_name (const char *name) {
+	struct list_elem *e;
+
+	for (e = list_begin (&segments); e != list_end (&segments);
+			e = list_next (e)) {
+		struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+		if (!strcmp (seg->name, name))
+			return seg;
+	}
+	return NULL;
+}
+
+/* OPENS에 SEG의 핸들이 있는지 확인합니다. */
+static bool
+shm_is_open (struct list *opens, struct shm_segment *seg) {
+	struct list_elem *e;
+
+	for (e = list_begin (opens); e != list_end (opens); e = list_next (e))
+		if (list_entry (e, struct shm_handle, elem)->seg == seg)
+			return true;
+	return false;
+}
+
+/* 이름이 NAME이고 SIZE 바이트 크기인 세그먼트를 만들어 목록에 넣습니다.
+ * 참조는 아직 없습니다. 메모리가 부족하면 NULL을 반환합니다. SHM_LOCK을
+ * 쥐고 호출합니다. */
+static struct shm_segment *
+shm_segment_create (const char *name, size_t size) {
+	struct shm_segment *seg;
+	size_t i;
+
+	seg = malloc (sizeof *seg);
+	if (seg == NULL)
+		return NULL;
+	seg->page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	seg->pages = malloc (seg->page_cnt * sizeof *seg->pages);
+	if (seg->pages == NULL) {
+		free (seg);
+		return NULL;
+	}
+	for (i = 0; i < seg->page_cnt; i++) {
+		seg->pages[i].frame = NULL;
+		seg->pages[i].slot = BITMAP_ERROR;
+		seg->pages[i].kpage = NULL;
+	}
+	strlcpy (seg->name, name, sizeof seg->name);
+	seg->id = next_id++;
+	seg->ref_cnt = 0;
+	lock_init (&seg->lock);
+	list_push_back (&segments, &seg->elem);
+	return seg;
+}
+
+/* shm_open을 수행합니다.
+ * 이름이 NAME인 세그먼트의 식별자를 반환합니다. 없으면 SIZE 바이트
+ * 크기로 새로 만듭니다. 새 세그먼트의 내용은 모두 0이며, 프레임은
+ * 처음 접근할 때에야 할당됩니다. 현재 프로세스가 처음 여는 세그먼트면
+ * 프로세스가 끝날 때까지 참조를 하나 가집니다. 이미 있는 세그먼트가
+ * SIZE보다 작거나, 이름이나 크기가 잘못되었거나, 메모리가 부족하면 -1을
+ * 반환합니다. */
+int
+do_shm_open (const char *name, size_t size) {
+	struct list *opens = &thread_current ()->spt.shm_opens;
+	struct shm_segment *seg;
+	struct shm_handle *h;
+	int id = -1;
+
+	if (strlen (name) == 0 || strlen (name) > SHM_NAME_MAX || size == 0
+			|| size > USER_STACK)
+		return -1;
+
+	h = malloc (sizeof *h);
+	if (h == NULL)
+		return -1;
+
+	lock_acquire (&shm_lock);
+	seg = shm_find_name (name);
+	if (seg == NULL)
+		seg = shm_segment_create (name, size);
+	else if (size > seg->page_cnt * PGSIZE)
+		seg = NULL;
+	if (seg != NULL) {
+		id = seg->id;
+		if (!shm_is_open (opens, seg)) {
+			h->seg = seg;
+			seg->ref_cnt++;
+			list_push_back (opens, &h->elem);
+			h = NULL;
+		}
+	}
+	lock_release (&shm_lock);
+
+	free (h);
+	return id;
+}
+
+/* shm_map을 수행합니다.
+ * 세그먼트 ID 전체를 현재 프로세스의 ADDR에 쓰기 가능하게 매핑하고
+ * ADDR을 반환합니다. 세그먼트가 없거나, ADDR이 잘못되었거나, 기존
+ * 매핑과 겹치면 NULL을 반환합니다. */
+void *
+do_shm_map (int id, void *addr) {
+	struct shm_segment *seg;
+	struct vma *vma;
+	size_t length;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || !is_user_vaddr (addr))
+		return NULL;
+
+	lock_acquire (&shm_lock);
+	seg = shm_find_id (id);
+	if (seg != NULL)
+		seg->ref_cnt++;
+	lock_release (&shm_lock);
+	if (seg == NULL)
+		return NULL;
+
+	length = seg->page_cnt * PGSIZE;
+	if ((uint64_t) addr + length < (uint64_t) addr
+			|| !is_user_vaddr ((uint8_t *) addr + length - 1)) {
+		shm_segment_put (seg);
+		return NULL;
+	}
+
+	vma = vma_create (VM_ANON | VM_SHM, addr, length, true, NULL, 0, 0);
+	if (vma == NULL) {
+		shm_segment_put (seg);
+		return NULL;
+	}
+	/* 여기서부터 세그먼트의 참조는 VMA가 가지고 vma_destroy()가 놓습니다. */
+	vma->shm = seg;
+	if (!spt_insert_vma (&thread_current ()->spt, vma)) {
+		vma_destroy (vma);
+		return NULL;
+	}
+	return addr;
+}
+
+/* shm_unmap을 수행합니다.
+ * ADDR에서 시작하는 공유 메모리 매핑을 제거합니다. 그런 매핑이 없으면
+ * -1을, 아니면 0을 반환합니다. */
+int
+do_shm_unmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma = vma_tree_find (&spt->vmas, addr);
+
+	if (vma == NULL || vma->start != addr || vma->shm == NULL)
+		return -1;
+	spt_remove_vma (spt, vma);
+	return 0;
+}
+
+/* SEG를 매핑하는 VMA가 하나 늘었음을 기록합니다. */
+void
+shm_segment_get (struct shm_segment *seg) {
+	lock_acquire (&shm_lock);
+	seg->ref_cnt++;
+	lock_release (&shm_lock);
+}
+
+/* SEG의 참조 하나를 놓습니다. 마지막 참조였다면 세그먼트를 해제합니다.
+ * 그때는 매핑이 남아 있지 않아 모든 페이지가 이미 제거되었으므로
+ * 프레임은 없고 스왑 슬롯과 커널 페이지만 돌려주면 됩니다. */
+void
+shm_segment_put (struct shm_segment *seg) {
+	size_t i;
+
+	lock_acquire (&shm_lock);
+	ASSERT (seg->ref_cnt > 0);
+	if (--seg->ref_cnt > 0) {
+		lock_release (&shm_lock);
+		return;
+	}
+	list_remove (&seg->elem);
+	lock_release (&shm_lock);
+
+	for (i = 0; i < seg->page_cnt; i++) {
+		ASSERT (seg->pages[i].frame == NULL);
+		if (seg->pages[i].slot != BITMAP_ERROR)
+			swap_slot_put (seg->pages[i].slot);
+		palloc_free_page (seg->pages[i].kpage);
+	}
+	free (seg->pages);
+	free (seg);
+}
+
+/* 프로세스가 끝날 때 SPT로 연 세그먼트들의 참조를 모두 놓습니다. */
+void
+shm_exit (struct supplemental_page_table *spt) {
+	while (!list_empty (&spt->shm_opens)) {
+		struct shm_handle *h = list_entry (list_pop_front (&spt->shm_opens),
+				struct shm_handle, elem);
+
+		shm_segment_put (h->seg);
+		free (h);
+	}
+}
+
+/* 공유 메모리 페이지 PAGE에 해당하는 세그먼트 페이지를 반환합니다. */
+struct shm_page *
+shm_lookup (struct page *page) {
+	struct vma *vma = page->vma;
+	size_t idx = ((uint8_t *) page->va - (uint8_t *) vma->start) / PGSIZE;
+
+	ASSERT (vma->shm != NULL && idx < vma->shm->page_cnt);
+	return &vma->shm->pages[idx];
+}
+
+/* 공유 메모리 페이지를 초기화합니다. */
+bool
+shm_initializer (struct page *page, enum vm_type type UNUSED, void *kva) {
+	page->operations = &shm_ops;
+	return shm_swap_in (page, kva);
+}
+
+/* 해제되거나 축출된 FRAME을 세그먼트에서 뗍니다. 이후 그 페이지에 폴트가
+ * 나면 스왑 슬롯에서, 슬롯이 없으면 0으로 다시 채웁니다. FRAME_LOCK을
+ * 쥐고 호출합니다. */
+void
+shm_frame_freed (struct frame *frame) {
+	if (frame->shm == NULL)
+		return;
+	ASSERT (frame->shm->frame == frame);
+	frame->shm->frame = NULL;
+	frame->shm = NULL;
+}
+
+/* PAGE의 새 프레임 KVA를 세그먼트의 내용으로 채우고, 그 프레임을
+ * 세그먼트 페이지의 프레임으로 등록합니다. 세그먼트 잠금을 쥐고 호출되므로
+ * 다른 프로세스가 같은 페이지를 동시에 채우지 않습니다. PAGE가 이미
+ * 세그먼트의 프레임을 함께 쓰고 있다면 할 일이 없습니다. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm_page *sp = shm_lookup (page);
+
+	if (sp->frame == page->frame)
+		return true;
+
+	if (sp->slot != BITMAP_ERROR) {
+		swap_read (sp->slot, kva);
+		swap_slot_put (sp->slot);
+		sp->slot = BITMAP_ERROR;
+	} else if (sp->kpage != NULL) {
+		memcpy (kva, sp->kpage, PGSIZE);
+		palloc_free_page (sp->kpage);
+		sp->kpage = NULL;
+	} else
+		memset (kva, 0, PGSIZE);
+
+	lock_acquire (&frame_lock);
+	sp->frame = page->frame;
+	page->frame->shm = sp;
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* 축출되는 프레임의 내용을 세그먼트의 스왑 슬롯에 씁니다. 같은 프레임을
+ * 쓰는 페이지들 중 처음 불린 페이지만 실제로 쓰고, 슬롯의 참조는
+ * 세그먼트가 하나만 가집니다. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm_page *sp = shm_lookup (page);
+
+	if (sp->slot == BITMAP_ERROR) {
+		sp->slot = swap_write (page->frame);
+		if (sp->slot == BITMAP_ERROR)
+			return false;
+	}
+	return true;
+}
+
+/* 공유 메모리 페이지를 파괴합니다. PAGE는 호출자에 의해 해제됩니다.
+ * 다른 참조가 아직 세그먼트에 남아 있으면, PAGE가 프레임의
+ * 마지막 사용자일 때 내용을 스왑으로 내보낸 뒤에 놓아 잃지 않습니다.
+ * 스왑이 가득 차 내보내지 못하면 커널 페이지에 복사해 둡니다. 그마저
+ * 얻지 못하면 세그먼트의 내용을 잃게 되므로 커널을 멈춥니다. 세그먼트
+ * 잠금을 쥐고 하므로 그 사이 다른 프로세스가 프레임을 함께 쓰기
+ * 시작하지 않습니다. */
+static void
+shm_destroy (struct page *page) {
+	struct shm_segment *seg = page->vma->shm;
+	struct shm_page *sp = shm_lookup (page);
+
+	lock_acquire (&seg->lock);
+	if (seg->ref_cnt > 1 && !vm_drop_frame (page) && vm_pin_frame (page)) {
+		if (page->frame->ref_cnt == 1 && sp->slot == BITMAP_ERROR) {
+			sp->kpage = palloc_get_page (0);
+			if (sp->kpage == NULL)
+				PANIC ("out of swap and memory for shared memory page");
+			memcpy (sp->kpage, page->frame->kva, PGSIZE);
+		}
+		vm_unpin_frame (page);
+	}
+	vm_release_frame (page);
+	lock_release (&seg->lock);
+}
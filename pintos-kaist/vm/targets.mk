@@ -2,4 +2,9 @@ vm_SRC = vm/vm.c          # 메인 api 프록시
 vm_SRC += vm/uninit.c     # 초기화되지 않은 페이지
 vm_SRC += vm/anon.c       # 익명 페이지
 vm_SRC += vm/file.c       # 파일 매핑된 페이지
+vm_SRC += vm/vma.c        # 가상 메모리 영역 구간 트리
+vm_SRC += vm/ksm.c        # 같은 내용의 익명 페이지 병합
+vm_SRC += vm/share.c      # 읽기 전용 파일 페이지 공유
+vm_SRC += vm/shm.c        # 프로세스 사이의 공유 메모리
+vm_SRC += vm/kswapd.c     # 백그라운드 페이지 회수
 vm_SRC += vm/inspect.c    # 테스트 유틸리티
@@ -7,6 +7,9 @@
  * (anon, file, page_cache)로 변환합니다.
  * */
 
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/uninit.h"
 
@@ -50,7 +53,11 @@ uninit_initialize (struct page *page, void *kva) {
 	vm_initializer *init = uninit->init;
 	void *aux = uninit->aux;
 
-	/* TODO: 이 함수를 수정해야 할 수도 있습니다. */
+	/* 초기화 콜백이 없는 페이지는 0으로 채워진 페이지입니다. 콜백이 있으면
+	 * 콜백이 프레임 전체를 채우므로 굳이 미리 지우지 않습니다. */
+	if (init == NULL)
+		memset (kva, 0, PGSIZE);
+
 	return uninit->page_initializer (page, uninit->type, kva) &&
 		(init ? init (page, aux) : true);
 }
@@ -60,7 +67,11 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE는 호출자에 의해 해제됩니다. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
-	/* TODO: 이 함수를 채우세요.
-	 * TODO: 할 일이 없으면 그냥 return하세요. */
+	struct uninit_page *uninit = &page->uninit;
+
+	/* 제로 프레임에 읽기 전용으로 매핑되어 있었다면 그 매핑을 끊습니다.
+	 * AUX는 페이지가 소유하며, 초기화 콜백이 한 번도 불리지 않았으므로
+	 * 여기서 해제합니다. */
+	vm_release_frame (page);
+	free (uninit->aux);
 }
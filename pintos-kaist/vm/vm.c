@@ -1,20 +1,123 @@
 /* vm.c: 가상 메모리 객체를 위한 일반적인 인터페이스. */
 
+#include <bitmap.h>
+#include <limits.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "intrinsic.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/ksm.h"
+#include "vm/kswapd.h"
+#include "vm/share.h"
+
+/* 사용자 스택이 자랄 수 있는 최대 크기 */
+#define STACK_LIMIT (1 << 20)
+
+/* 폴트 어라운드 창의 초기 크기 (페이지) */
+#define FAULT_AROUND_INIT 4
+
+/* 폴트 어라운드 창의 최대 페이지 수.
+ * 커널 명령줄 옵션 "-fa=N"으로 조절합니다. */
+size_t fault_around_pages = 16;
+
+/* 전역 제로 프레임.
+ * 한 번도 쓰이지 않은 익명 페이지에 대한 읽기 폴트는 새 프레임을 할당하는 대신
+ * 이 프레임을 읽기 전용으로 매핑합니다. 첫 번째 쓰기가 쓰기 보호 폴트를 일으키면
+ * 그때 비로소 개인 프레임을 할당합니다. */
+static struct frame zero_frame;
+
+struct frame *frame_table;
+size_t frame_cnt;
+struct lock frame_lock;
+
+/* 프레임 테이블이 덮는 사용자 풀의 시작 주소 */
+static uint8_t *frame_base;
+
+/* 시계 알고리즘이 다음에 볼 프레임 테이블 위치 */
+static size_t clock_hand;
+
+/* 상한에 닿은 프로세스가 자기 프레임을 고를 때 쓰는 시계 바늘 */
+static size_t own_hand;
+
+/* 축출이 끝날 때마다 신호를 받습니다. FRAME_LOCK과 함께 씁니다. */
+static struct condition evict_done;
+
+/* 사용자 풀에 남은 프레임 수 */
+static size_t free_frames;
+
+/* 통계 */
+static struct {
+	long long cnt;                  /* 폴트 수 */
+	long long sectors;              /* 처리하며 읽고 쓴 디스크 섹터 수 */
+	long long hist[64];             /* 처리 시간의 log2 히스토그램 (사이클) */
+} fault_stats[FAULT_TYPE_CNT];      /* 폴트 종류별 통계 */
+static long long direct_evict_cnt;  /* 폴트 경로에서 직접 축출한 프레임 수 */
+static long long limit_evict_cnt;   /* 상주 페이지 상한 때문에 축출한 프레임 수 */
+
+static const char *fault_names[FAULT_TYPE_CNT] = {
+	"stack", "elf", "mmap", "zero", "swap", "cow", "invalid",
+};
+
+/* 최근에 끝난 프로세스들의 폴트 통계. 종료 전원을 끌 때 출력합니다. */
+#define FAULT_LOG_CNT 16
+static struct {
+	char name[16];
+	tid_t tid;
+	struct faultstat faults;
+} fault_log[FAULT_LOG_CNT];
+static size_t fault_log_cnt;        /* 지금까지 기록한 프로세스 수 */
+
+/* 사용자 풀 전체를 덮는 프레임 테이블을 만듭니다. 테이블은 커널 풀에서
+ * 한 번에 할당하고 끝까지 해제하지 않습니다. */
+static void
+vm_frame_table_init (void) {
+	size_t i;
+
+	frame_base = palloc_user_base ();
+	frame_cnt = palloc_user_page_cnt ();
+	frame_table = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP (frame_cnt * sizeof *frame_table, PGSIZE));
+
+	for (i = 0; i < frame_cnt; i++) {
+		frame_table[i].kva = frame_base + i * PGSIZE;
+		list_init (&frame_table[i].pages);
+	}
+}
 
 /* 각 하위 시스템의 초기화 코드를 호출하여 가상 메모리 하위 시스템을 초기화합니다. */
 void
 vm_init (void) {
 	vm_anon_init ();
 	vm_file_init ();
-#ifdef EFILESYS  /* For project 4 */
-	pagecache_init ();
-#endif
 	register_inspect_intr ();
 	/* 위의 줄들을 수정하지 마세요. */
-	/* TODO: 여기에 코드를 작성하세요. */
+	zero_frame.kva = palloc_get_page (PAL_USER | PAL_ZERO | PAL_ASSERT);
+	zero_frame.page = NULL;
+	vm_frame_table_init ();
+	lock_init (&frame_lock);
+	cond_init (&evict_done);
+	free_frames = palloc_user_free_cnt ();
+	share_init ();
+	shm_init ();
+	ksm_init ();
+	kswapd_init ();
+}
+
+/* 사용자 풀의 페이지 KVA에 해당하는 프레임을 반환합니다. */
+struct frame *
+vm_frame_lookup (void *kva) {
+	size_t idx = pg_no (kva) - pg_no (frame_base);
+
+	ASSERT (pg_ofs (kva) == 0);
+	ASSERT (idx < frame_cnt);
+	return &frame_table[idx];
 }
 
 /* 페이지의 타입을 가져옵니다. 이 함수는 페이지가 초기화된 후의 타입을 알고 싶을 때 유용합니다.
@@ -34,6 +137,24 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static bool vm_is_zero_fill (struct page *page);
+static bool vm_map_zero_frame (struct page *page);
+static bool vm_is_lazy_file (struct page *page);
+static void vm_fault_around (struct page *page);
+static struct page *vm_alloc_vma_page (struct vma *vma, void *va);
+static struct page *vm_get_page (void *va);
+static bool vm_claim_frame (struct page *page);
+static bool vm_is_shared_file (struct page *page);
+static bool vm_claim_shared (struct page *page);
+static bool vm_is_shm (struct page *page);
+static bool vm_claim_shm (struct page *page);
+static void vm_wait_frame (struct page *page);
+static bool vm_evict (struct frame *frame);
+static void vm_add_free_frames (int cnt);
+static bool vm_pin_page (struct page *page);
+static void vm_free_frame (struct frame *frame);
+static bool is_stack_access (void *addr, void *rsp);
+static void vm_drop_behind (struct vma *vma, void *va, size_t window);
 
 /* 초기화자와 함께 대기 중인 페이지 객체를 생성합니다. 페이지를 생성하고 싶다면,
  * 직접 생성하지 말고 이 함수나 `vm_alloc_page`를 통해 만드세요. */
@@ -47,11 +168,35 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	/* upage가 이미 사용 중인지 확인합니다. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: 페이지를 생성하고, VM 타입에 따라 초기화자를 가져와서
-		 * TODO: uninit_new를 호출하여 "uninit" 페이지 구조체를 생성하세요.
-		 * TODO: uninit_new를 호출한 후 필드를 수정해야 합니다. */
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		struct page *page;
+
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = (type & VM_SHM) ? shm_initializer
+					: anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
+
+		page = malloc (sizeof *page);
+		if (page == NULL)
+			goto err;
+
+		/* uninit_new는 페이지 전체를 덮어쓰므로 나머지 필드는 그 뒤에 채웁니다. */
+		uninit_new (page, upage, init, type, aux, initializer);
+		page->writable = writable;
+		page->owner = thread_current ();
 
-		/* TODO: 페이지를 spt에 삽입하세요. */
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
@@ -59,83 +204,883 @@ err:
 
 /* spt에서 VA를 찾아 페이지를 반환합니다. 오류 시 NULL을 반환합니다. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: 이 함수를 채우세요. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
 
-	return page;
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &key.spt_elem);
+	return e != NULL ? hash_entry (e, struct page, spt_elem) : NULL;
 }
 
 /* 검증과 함께 PAGE를 spt에 삽입합니다. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: 이 함수를 채우세요. */
+spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
+	ASSERT (pg_ofs (page->va) == 0);
 
-	return succ;
+	return hash_insert (&spt->pages, &page->spt_elem) == NULL;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->pages, &page->spt_elem);
+	if (page->vma != NULL)
+		list_remove (&page->vma_elem);
 	vm_dealloc_page (page);
-	return true;
 }
 
-/* 축출될 struct frame을 가져옵니다. */
+/* VMA를 spt에 넣습니다. 페이지는 만들지 않으므로 구간의 크기와 상관없이
+ * 상수 시간에 끝납니다. 기존 매핑과 겹치면 false를 반환합니다. */
+bool
+spt_insert_vma (struct supplemental_page_table *spt, struct vma *vma) {
+	return vma_tree_insert (&spt->vmas, vma);
+}
+
+/* VMA와 그 안에서 만들어진 페이지를 모두 spt에서 제거하고 해제합니다.
+ * 폴트가 난 적 없는 페이지는 애초에 없으므로 만들어진 페이지 수만큼만
+ * 일합니다. 파일 매핑이면 더러운 페이지를 먼저 모아서 파일에 쓰므로,
+ * 이후 페이지마다의 destroy는 I/O 없이 프레임만 돌려줍니다. */
+void
+spt_remove_vma (struct supplemental_page_table *spt, struct vma *vma) {
+	if (VM_TYPE (vma->type) == VM_FILE)
+		file_backed_flush (vma, vma->start, vma->end);
+	while (!list_empty (&vma->pages))
+		spt_remove_page (spt, list_entry (list_front (&vma->pages),
+					struct page, vma_elem));
+	vma_tree_remove (&spt->vmas, vma);
+	vma_destroy (vma);
+}
+
+/* VMA 안의 페이지 VA에 대한 struct page를 VMA의 정보로 만들어 spt에
+ * 넣습니다. 실패하면 NULL을 반환합니다. */
+static struct page *
+vm_alloc_vma_page (struct vma *vma, void *va) {
+	enum vm_type type = vma->type;
+	vm_initializer *init = NULL;
+	struct page *page;
+
+	va = pg_round_down (va);
+	if (vma_has_file_data (vma, va)) {
+		type |= VM_LAZY_FILE;
+		init = vma_load_page;
+	}
+	if (!vm_alloc_page_with_initializer (type, va, vma->writable, init, NULL))
+		return NULL;
+
+	page = spt_find_page (&thread_current ()->spt, va);
+	page->vma = vma;
+	list_push_back (&vma->pages, &page->vma_elem);
+	return page;
+}
+
+/* VA의 struct page를 반환합니다. 아직 없으면 VA를 포함하는 VMA로부터
+ * 만듭니다. VA가 어떤 매핑에도 속하지 않으면 NULL을 반환합니다. */
+static struct page *
+vm_get_page (void *va) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_find_page (spt, va);
+	struct vma *vma;
+
+	if (page != NULL)
+		return page;
+	vma = vma_tree_find (&spt->vmas, va);
+	return vma != NULL ? vm_alloc_vma_page (vma, va) : NULL;
+}
+
+/* FRAME을 매핑한 페이지 중 최근에 접근된 것이 있으면 true를 반환하고,
+ * 모든 페이지의 접근 비트를 지웁니다. */
+static bool
+vm_frame_accessed (struct frame *frame) {
+	bool accessed = false;
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* FRAME이 MADV_SEQUENTIAL로 알린 매핑의 페이지이면 true를 반환합니다.
+ * 한 번 훑고 지나갈 내용이므로 최근에 접근했더라도 다시 기회를 주지
+ * 않고 먼저 축출합니다. */
+static bool
+vm_frame_streaming (struct frame *frame) {
+	struct vma *vma = frame->page->vma;
+
+	return vma != NULL && vma->advice == MADV_SEQUENTIAL;
+}
+
+/* 프로세스 T가 상주 페이지 상한에 닿았으면 true를 반환합니다. */
+static bool
+vm_over_limit (struct thread *t) {
+	return t->rss_limit != 0 && t->rss >= t->rss_limit;
+}
+
+/* 프로세스 T의 상주 페이지 수를 CNT만큼 바꿉니다. 다른 스레드의 축출과
+ * 동시에 바뀔 수 있으므로 인터럽트를 끄고 바꿉니다. */
+static void
+vm_add_rss (struct thread *t, int cnt) {
+	enum intr_level old_level = intr_disable ();
+	t->rss += cnt;
+	intr_set_level (old_level);
+}
+
+/* 프로세스 T가 스왑에 내보낸 페이지 수를 CNT만큼 바꿉니다. */
+void
+vm_add_swap (struct thread *t, int cnt) {
+	enum intr_level old_level = intr_disable ();
+	t->swap_cnt += cnt;
+	intr_set_level (old_level);
+}
+
+/* 현재 프로세스의 상주 페이지 상한을 LIMIT 페이지로 정합니다. 0이면
+ * 상한을 없앱니다. 이미 상한을 넘었다면 다음 폴트부터 자기 페이지를
+ * 내보내며 줄어듭니다. */
+void
+vm_set_rss_limit (size_t limit) {
+	thread_current ()->rss_limit = limit;
+}
+
+/* 축출될 struct frame을 가져옵니다.
+ * 프레임 테이블을 CLOCK_HAND부터 차례로 돌면서, 사용 중이고 고정되지
+ * 않았고 어떤 페이지도 최근에 접근하지 않은 프레임을 고릅니다. 접근된 프레임은 접근 비트를
+ * 지우고 한 번 더 기회를 주되, 순차 접근 매핑의 프레임과 상주 페이지
+ * 상한에 닿은 프로세스의 프레임은 그러지 않습니다.
+ * FRAME_LOCK을 쥐고 호출합니다. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: 축출 정책은 여러분이 정하세요. */
+	size_t n = 2 * frame_cnt;
 
-	return victim;
+	while (n-- > 0) {
+		struct frame *frame = &frame_table[clock_hand];
+
+		clock_hand = (clock_hand + 1) % frame_cnt;
+		if (!frame->in_use || frame->pin_cnt > 0 || frame->evicting)
+			continue;
+		if (!vm_frame_accessed (frame) || vm_frame_streaming (frame)
+				|| vm_over_limit (frame->page->owner))
+			return frame;
+	}
+	return NULL;
+}
+
+/* 프로세스 T만 쓰는 프레임 중 축출될 것을 가져옵니다. 고르는 방법은
+ * vm_get_victim()과 같되 OWN_HAND를 씁니다. FRAME_LOCK을 쥐고 호출합니다. */
+static struct frame *
+vm_get_own_victim (struct thread *t) {
+	size_t n = 2 * frame_cnt;
+
+	while (n-- > 0) {
+		struct frame *frame = &frame_table[own_hand];
+
+		own_hand = (own_hand + 1) % frame_cnt;
+		if (!frame->in_use || frame->pin_cnt > 0 || frame->evicting
+				|| frame->ref_cnt != 1 || frame->page->owner != t)
+			continue;
+		if (!vm_frame_accessed (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+/* FRAME을 쓰는 모든 페이지의 매핑을 끊고 내용을 내보냅니다.
+ * FRAME_LOCK을 쥐고 호출하며, 입출력을 하는 동안에는 잠금을 놓습니다.
+ * 그 사이 이 프레임의 페이지에 접근하거나 페이지를 해제하려는 스레드는
+ * vm_wait_frame()에서 기다립니다. 성공하면 FRAME은 어떤 페이지와도
+ * 연결되지 않은 채 사용 중 표시가 풀리고, 실패하면 매핑을 되돌립니다. */
+static bool
+vm_evict (struct frame *frame) {
+	struct list_elem *e;
+	bool success = true;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (frame->pin_cnt == 0 && !frame->evicting);
+
+	/* 내보내는 동안 다른 페이지가 이 프레임을 찾아 쓰지 않도록 합니다. */
+	ksm_frame_freed (frame);
+	share_remove (frame);
+	frame->evicting = true;
+	frame->swap_slot = BITMAP_ERROR;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+	lock_release (&frame_lock);
+
+	/* 공유 프레임이면 첫 페이지가 내용을 쓰고 나머지는 그 결과를 함께
+	 * 씁니다. */
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e))
+		if (!swap_out (list_entry (e, struct page, frame_elem))) {
+			success = false;
+			break;
+		}
+
+	lock_acquire (&frame_lock);
+	if (success) {
+		shm_frame_freed (frame);
+		while (!list_empty (&frame->pages)) {
+			struct page *page = list_entry (list_pop_front (&frame->pages),
+					struct page, frame_elem);
+			page->frame = NULL;
+			vm_add_rss (page->owner, -1);
+		}
+		frame->ref_cnt = 0;
+		frame->page = NULL;
+		frame->in_use = false;
+	} else {
+		bool writable = frame->ref_cnt == 1 || frame->shm != NULL;
+
+		for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+				e = list_next (e)) {
+			struct page *page = list_entry (e, struct page, frame_elem);
+			pml4_set_page (page->owner->pml4, page->va, frame->kva,
+					writable && page->writable);
+		}
+	}
+	frame->evicting = false;
+	cond_broadcast (&evict_done, &frame_lock);
+	return success;
+}
+
+/* PAGE의 프레임이 축출되는 중이면 끝날 때까지 기다립니다. 축출이 끝나면
+ * PAGE의 프레임은 NULL이 되어 있을 수 있습니다. FRAME_LOCK을 쥐고
+ * 호출합니다. */
+static void
+vm_wait_frame (struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait (&evict_done, &frame_lock);
 }
 
 /* 하나의 페이지를 축출하고 해당 프레임을 반환합니다.
  * 오류 시 NULL을 반환합니다. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: victim을 스왑 아웃하고 축출된 프레임을 반환하세요. */
+	struct frame *victim;
 
-	return NULL;
+	lock_acquire (&frame_lock);
+	victim = vm_get_victim ();
+	if (victim != NULL && !vm_evict (victim))
+		victim = NULL;
+	lock_release (&frame_lock);
+
+	if (victim != NULL)
+		direct_evict_cnt++;
+	return victim;
+}
+
+/* 프로세스 T가 상주 페이지 상한에 닿았으면 자기 프레임 하나를 축출해
+ * 반환합니다. 상한 아래이거나 내보낼 자기 프레임이 없으면 NULL을
+ * 반환합니다. */
+static struct frame *
+vm_evict_own_frame (struct thread *t) {
+	struct frame *victim;
+
+	if (!vm_over_limit (t))
+		return NULL;
+
+	lock_acquire (&frame_lock);
+	victim = vm_get_own_victim (t);
+	if (victim != NULL && !vm_evict (victim))
+		victim = NULL;
+	lock_release (&frame_lock);
+
+	if (victim != NULL)
+		limit_evict_cnt++;
+	return victim;
+}
+
+/* 프레임 하나를 축출해 사용자 풀에 돌려줍니다. kswapd가 호출합니다.
+ * 축출할 프레임이 없으면 false를 반환합니다. */
+bool
+vm_reclaim (void) {
+	struct frame *victim;
+
+	lock_acquire (&frame_lock);
+	victim = vm_get_victim ();
+	if (victim != NULL && !vm_evict (victim))
+		victim = NULL;
+	lock_release (&frame_lock);
+
+	if (victim == NULL)
+		return false;
+	vm_free_frame (victim);
+	return true;
+}
+
+/* 사용자 풀에 남은 프레임 수를 반환합니다. */
+size_t
+vm_free_frames (void) {
+	return free_frames;
+}
+
+/* 사용자 풀에 남은 프레임 수를 CNT만큼 바꿉니다. */
+static void
+vm_add_free_frames (int cnt) {
+	enum intr_level old_level = intr_disable ();
+	free_frames += cnt;
+	intr_set_level (old_level);
 }
 
 /* palloc()을 호출하여 프레임을 가져옵니다. 사용 가능한 페이지가 없으면 페이지를 축출하고
  * 반환합니다. 이 함수는 항상 유효한 주소를 반환합니다. 즉, 사용자 풀 메모리가 가득 찬 경우
- * 이 함수는 사용 가능한 메모리 공간을 얻기 위해 프레임을 축출합니다. */
+ * 이 함수는 사용 가능한 메모리 공간을 얻기 위해 프레임을 축출합니다.
+ * 남은 프레임이 낮은 워터마크 아래로 내려가면 kswapd를 깨워, 보통은 폴트
+ * 경로에서 직접 축출할 일이 없게 합니다. */
 static struct frame *
 vm_get_frame (void) {
-	struct frame *frame = NULL;
-	/* TODO: 이 함수를 채우세요. */
+	/* 상주 페이지 상한에 닿은 프로세스는 다른 프로세스의 프레임을
+	 * 가져가기 전에 자기 프레임부터 내보내 다시 씁니다. */
+	struct frame *frame = vm_evict_own_frame (thread_current ());
+
+	if (frame == NULL) {
+		void *kva = palloc_get_page (PAL_USER);
+
+		if (kva != NULL) {
+			frame = vm_frame_lookup (kva);
+			vm_add_free_frames (-1);
+		} else {
+			frame = vm_evict_frame ();
+			if (frame == NULL)
+				return NULL;
+		}
+	}
+	kswapd_poke (free_frames);
+
+	ASSERT (!frame->in_use && list_empty (&frame->pages));
+	frame->page = NULL;
+	frame->ref_cnt = 0;
+	frame->pin_cnt = 0;
+	frame->evicting = false;
+	frame->swap_slot = BITMAP_ERROR;
+	frame->shm = NULL;
+	frame->inode = NULL;
+	frame->checksum = 0;
+	frame->merged = false;
+	frame->unstable = false;
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
 	return frame;
 }
 
-/* 스택을 증가시킵니다. */
+/* 아무 페이지에도 연결되지 않은 FRAME을 해제합니다. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+vm_free_frame (struct frame *frame) {
+	ASSERT (frame->ref_cnt == 0);
+
+	palloc_free_page (frame->kva);
+	vm_add_free_frames (1);
+}
+
+/* PAGE를 FRAME의 역매핑에 추가하고 PAGE의 주인 주소 공간에 매핑합니다.
+ * 호출자는 FRAME_LOCK을 쥐고 있거나, FRAME이 아직 사용 중으로 표시되지
+ * 않아 다른 스레드가 건드리지 않아야 합니다. */
+bool
+vm_frame_link (struct frame *frame, struct page *page, bool writable) {
+	ASSERT (page->frame == NULL);
+
+	list_push_back (&frame->pages, &page->frame_elem);
+	frame->ref_cnt++;
+	if (frame->page == NULL)
+		frame->page = page;
+	page->frame = frame;
+	vm_add_rss (page->owner, 1);
+	return vm_page_set_writable (page, writable);
+}
+
+/* PAGE의 매핑을 끊고 FRAME의 역매핑에서 뺍니다. 마지막 페이지였다면
+ * 프레임의 사용 중 표시를 풀고 해제합니다. 호출자는 FRAME_LOCK을
+ * 쥐고 있어야 합니다. */
+void
+vm_frame_unlink (struct page *page) {
+	struct frame *frame = page->frame;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	pml4_clear_page (page->owner->pml4, page->va);
+	page->frame = NULL;
+	if (frame == &zero_frame)
+		return;
+
+	list_remove (&page->frame_elem);
+	frame->ref_cnt--;
+	vm_add_rss (page->owner, -1);
+	if (frame->page == page)
+		frame->page = list_empty (&frame->pages) ? NULL
+			: list_entry (list_front (&frame->pages), struct page, frame_elem);
+
+	if (frame->ref_cnt == 0) {
+		ksm_frame_freed (frame);
+		share_remove (frame);
+		shm_frame_freed (frame);
+		frame->in_use = false;
+		vm_free_frame (frame);
+	}
+}
+
+/* PAGE의 페이지 테이블 항목을 지금 프레임에 대해 WRITABLE 권한으로 다시
+ * 씁니다. 현재 주소 공간이라면 TLB의 옛 항목도 무효화됩니다. */
+bool
+vm_page_set_writable (struct page *page, bool writable) {
+	uint64_t *pml4 = page->owner->pml4;
+
+	pml4_clear_page (pml4, page->va);
+	return pml4_set_page (pml4, page->va, page->frame->kva, writable);
+}
+
+/* 스택을 증가시킵니다.
+ * 스택 VMA의 시작을 ADDR이 속한 페이지까지 내릴 뿐, 페이지는 폴트가
+ * 날 때 만들어집니다. */
+static void
+vm_stack_growth (void *addr) {
+	struct vma_tree *vmas = &thread_current ()->spt.vmas;
+	struct vma *stack = vma_tree_find (vmas, (uint8_t *) USER_STACK - 1);
+
+	if (stack != NULL)
+		vma_tree_grow_down (vmas, stack, pg_round_down (addr));
+}
+
+/* RSP를 스택 포인터로 하는 스레드의 ADDR 접근이 스택 확장 요청으로
+ * 볼 수 있으면 true를 반환합니다. PUSH 명령은 RSP보다 8바이트 아래를
+ * 먼저 검사하므로 그만큼의 여유를 둡니다. */
+static bool
+is_stack_access (void *addr, void *rsp) {
+	return (uint8_t *) addr < (uint8_t *) USER_STACK
+		&& (uint8_t *) addr >= (uint8_t *) USER_STACK - STACK_LIMIT
+		&& (uint8_t *) addr >= (uint8_t *) rsp - 8;
 }
 
 /* 쓰기 보호된 페이지의 폴트를 처리합니다 */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct frame *frame, *copy;
+	bool success;
+
+	if (!page->writable)
+		return false;
+
+	/* 제로 프레임을 보고 있던 페이지에 대한 첫 쓰기.
+	 * 읽기 전용 매핑을 걷어내고 개인 프레임을 할당합니다. */
+	if (page->frame == &zero_frame) {
+		pml4_clear_page (thread_current ()->pml4, page->va);
+		page->frame = NULL;
+		return vm_do_claim_page (page);
+	}
+
+	/* 여러 페이지가 공유하는 읽기 전용 프레임에 대한 쓰기. 쓰기 시 복사로
+	 * 공유를 깹니다. 복사본 프레임은 잠금을 쥐기 전에 미리 얻어 둡니다. */
+	copy = vm_get_frame ();
+	if (copy == NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	vm_wait_frame (page);
+	frame = page->frame;
+	if (frame == NULL) {
+		/* 그 사이 축출되었습니다. 다시 접근하면 새로 클레임됩니다. */
+		success = true;
+	} else {
+		ksm_unmerge (frame);
+		if (frame->ref_cnt == 1) {
+			/* 마지막 사용자이거나, KSM이 비교하는 동안 잠시 쓰기 금지된
+			 * 페이지입니다. 그대로 쓰기를 허용합니다. */
+			success = vm_page_set_writable (page, true);
+		} else {
+			memcpy (copy->kva, frame->kva, PGSIZE);
+			vm_frame_unlink (page);
+			success = vm_frame_link (copy, page, true);
+			copy->in_use = true;
+			copy = NULL;
+		}
+	}
+	lock_release (&frame_lock);
+
+	if (copy != NULL)
+		vm_free_frame (copy);
+	return success;
 }
 
-/* 성공 시 true를 반환합니다 */
+/* PAGE가 아직 한 번도 쓰이지 않은, 0으로 채워질 익명 페이지이면 true를
+ * 반환합니다. BSS나 스택 확장 영역처럼 초기화 콜백 없이 생성된 익명
+ * 페이지가 여기에 해당합니다. */
+static bool
+vm_is_zero_fill (struct page *page) {
+	return page->operations->type == VM_UNINIT
+		&& VM_TYPE (page->uninit.type) == VM_ANON
+		&& (page->uninit.type & VM_SHM) == 0
+		&& page->uninit.init == NULL;
+}
+
+/* PAGE를 전역 제로 프레임에 읽기 전용으로 매핑합니다. 페이지는 uninit
+ * 상태로 남으며, 첫 쓰기에서 vm_handle_wp()가 개인 프레임을 할당합니다. */
+static bool
+vm_map_zero_frame (struct page *page) {
+	if (!pml4_set_page (thread_current ()->pml4, page->va,
+				zero_frame.kva, false))
+		return false;
+	page->frame = &zero_frame;
+	return true;
+}
+
+/* PAGE가 아직 읽히지 않은, 파일에서 지연 로딩되는 페이지이면 true를
+ * 반환합니다. */
+static bool
+vm_is_lazy_file (struct page *page) {
+	return page->operations->type == VM_UNINIT
+		&& (page->uninit.type & VM_LAZY_FILE) != 0;
+}
+
+/* 폴트 어라운드.
+ * 파일에서 지연 로딩되는 PAGE에 폴트가 나면, 같은 VMA 안에서 뒤따르는
+ * 파일 내용을 가진 페이지들을 창 크기만큼 같은 폴트 안에서 파일 오프셋
+ * 순서대로 읽어 매핑합니다.
+ * 직전 창을 모두 쓰고 바로 다음 페이지에서 폴트가 나면 순차 접근으로 보고
+ * 창을 두 배로 늘리고, 그 밖의 위치에서 폴트가 나면 절반으로 줄입니다.
+ * madvise()로 임의 접근을 알린 VMA에서는 하지 않고, 순차 접근을 알린
+ * VMA에서는 처음부터 최대 창으로 읽고 지나간 창의 프레임을 돌려줍니다. */
+static void
+vm_fault_around (struct page *page) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma = page->vma;
+	size_t window = spt->fa_window;
+	size_t i;
+
+	if (fault_around_pages <= 1 || vma->advice == MADV_RANDOM)
+		return;
+
+	if (vma->advice == MADV_SEQUENTIAL)
+		window = fault_around_pages;
+	else if (window == 0)
+		window = FAULT_AROUND_INIT;
+	else if (page->va == spt->fa_next)
+		window *= 2;
+	else
+		window /= 2;
+	window = max (window, 1);
+	window = min (window, fault_around_pages);
+
+	for (i = 1; i < window; i++) {
+		void *va = (uint8_t *) page->va + i * PGSIZE;
+		struct page *next;
+
+		if (va >= vma->end || !vma_has_file_data (vma, va))
+			break;
+		next = vm_get_page (va);
+		if (next == NULL || !vm_is_lazy_file (next))
+			break;
+		if (!vm_do_claim_page (next))
+			break;
+	}
+
+	spt->fa_window = window;
+	spt->fa_next = (uint8_t *) page->va + i * PGSIZE;
+
+	if (vma->advice == MADV_SEQUENTIAL)
+		vm_drop_behind (vma, page->va, window);
+}
+
+/* PAGE의 프레임을 당장 축출해 사용자 풀에 돌려줍니다. 다른 페이지와 함께
+ * 쓰거나 고정된 프레임은 건드리지 않습니다. 내용은 축출과 똑같이
+ * 보존되므로 다시 접근하면 읽어 들입니다. 프레임을 돌려주었으면 true를
+ * 반환합니다. */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
+vm_drop_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	vm_wait_frame (page);
+	frame = page->frame;
+	if (frame == NULL || frame == &zero_frame || !frame->in_use
+			|| frame->pin_cnt > 0 || frame->ref_cnt != 1 || !vm_evict (frame))
+		frame = NULL;
+	lock_release (&frame_lock);
+
+	if (frame != NULL)
+		vm_free_frame (frame);
+	return frame != NULL;
+}
+
+/* 순차 접근 VMA에서 VA에 폴트가 났을 때, 한 창 더 앞의 창, 즉
+ * [VA - 2 * WINDOW, VA - WINDOW) 페이지들의 프레임을 돌려줍니다. 바로 앞
+ * 창은 아직 쓰고 있을 수 있으므로 남겨 둡니다. */
+static void
+vm_drop_behind (struct vma *vma, void *va, size_t window) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t behind = ((uint8_t *) va - (uint8_t *) vma->start) / PGSIZE;
+	size_t i;
+
+	for (i = window + 1; i <= 2 * window && i <= behind; i++) {
+		struct page *page = spt_find_page (spt,
+				(uint8_t *) va - i * PGSIZE);
+
+		if (page != NULL && page->frame != NULL)
+			vm_drop_frame (page);
+	}
+}
+
+/* 현재 프로세스의 [START, END) 페이지들을 미리 폴트해서 프레임에 올립니다.
+ * 파일 내용은 파일 오프셋 순서대로 한 번에 읽습니다. 메모리가 부족해
+ * 클레임에 실패하면 거기서 멈춥니다. */
+void
+vm_populate (void *start, void *end) {
+	uint8_t *va;
+
+	for (va = start; va < (uint8_t *) end; va += PGSIZE) {
+		struct page *page = vm_get_page (va);
+
+		if (page == NULL)
+			continue;
+		if (page->frame == NULL && !vm_do_claim_page (page))
+			break;
+	}
+}
+
+/* 현재 프로세스의 [START, END) 페이지들을 버리고 프레임을 돌려줍니다.
+ * 공유 파일 매핑의 쓰인 내용은 파일에 다시 쓰입니다. 다음에 접근하면
+ * 페이지는 VMA로부터 새로 만들어지므로 익명 메모리는 0으로, 파일 매핑은
+ * 파일 내용으로 다시 채워집니다. */
+void
+vm_discard (void *start, void *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va;
+
+	for (va = start; va < (uint8_t *) end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+
+		if (page == NULL)
+			continue;
+		/* 공유 메모리의 내용은 다른 프로세스도 보므로 버리지 않고 프레임만
+		 * 돌려줍니다. */
+		if (vm_is_shm (page))
+			vm_drop_frame (page);
+		else
+			spt_remove_page (spt, page);
+	}
+}
+
+/* 현재 프로세스가 사용자 주소 VA에 접근해도 되는지, 즉 VA가 어떤 매핑에
+ * 속하거나 스택 확장으로 만들어질 수 있는지 검사합니다. WRITE이면 쓰기도
+ * 허용되어야 합니다. 시스템 콜이 사용자 버퍼를 쓰기 전에 호출합니다. */
+bool
+vm_check_access (void *va, bool write) {
+	struct thread *curr = thread_current ();
+	struct page *page = spt_find_page (&curr->spt, va);
+	struct vma *vma;
+
+	if (page != NULL)
+		return !write || page->writable;
+	vma = vma_tree_find (&curr->spt.vmas, va);
+	if (vma != NULL)
+		return !write || vma->writable;
+	return is_stack_access (va, (void *) curr->user_rsp);
+}
+
+/* TYPE 종류의 폴트 하나가 CYCLES 사이클 동안 SECTORS개의 섹터를 읽고
+ * 썼음을 전체 통계와 현재 프로세스의 통계에 기록합니다. */
+static void
+vm_record_fault (int type, uint64_t cycles, long long sectors) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	uint64_t c = cycles;
+	int bucket = 0;
+
+	while (c >>= 1)
+		bucket++;
+
+	old_level = intr_disable ();
+	fault_stats[type].hist[bucket]++;
+	fault_stats[type].cnt++;
+	fault_stats[type].sectors += sectors;
+	intr_set_level (old_level);
+
+	curr->faults.type[type].cnt++;
+	curr->faults.type[type].cycles += cycles;
+	curr->faults.type[type].sectors += sectors;
+}
+
+/* 프레임이 없는 PAGE에 대한 폴트의 종류를 반환합니다. */
+static int
+vm_fault_type (struct page *page) {
+	if (page->operations->type == VM_UNINIT) {
+		if ((page->uninit.type & VM_LAZY_FILE) == 0)
+			return FAULT_ZERO;
+		return VM_TYPE (page->uninit.type) == VM_FILE ? FAULT_MMAP : FAULT_ELF;
+	}
+	return page->operations->type == VM_FILE ? FAULT_MMAP : FAULT_SWAP;
+}
+
+/* 페이지 폴트를 처리합니다. 성공 시 true를 반환합니다.
+ * 폴트의 종류를 *TYPE에 넣습니다. */
+static bool
+vm_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present, int *type) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
 	struct page *page = NULL;
-	/* TODO: 폴트를 검증하세요 */
-	/* TODO: 여기에 코드를 작성하세요 */
+	bool stack = false;
+
+	*type = FAULT_INVALID;
+
+	/* 커널 주소나 NULL에 대한 폴트는 처리하지 않습니다. */
+	if (addr == NULL || !is_user_vaddr (addr))
+		return false;
+
+	if (spt_find_page (spt, addr) == NULL
+			&& vma_tree_find (&spt->vmas, addr) == NULL) {
+		/* 시스템 콜 도중의 폴트라면 F에는 커널 스택 포인터가 들어 있으므로
+		 * 시스템 콜 진입 시 저장해 둔 사용자 스택 포인터를 사용합니다. */
+		void *rsp = user ? (void *) f->rsp : (void *) curr->user_rsp;
+		if (!is_stack_access (addr, rsp))
+			return false;
+		vm_stack_growth (addr);
+		stack = true;
+	}
+
+	page = vm_get_page (addr);
+	if (page == NULL)
+		return false;
+
+	if (write && !page->writable)
+		return false;
+
+	/* 존재하는 페이지에 대한 폴트는 읽기 전용 매핑에 대한 쓰기뿐입니다. */
+	if (!not_present) {
+		if (!write)
+			return false;
+		*type = page->frame == &zero_frame ? FAULT_ZERO : FAULT_COW;
+		return vm_handle_wp (page);
+	}
+
+	*type = stack ? FAULT_STACK : vm_fault_type (page);
+
+	/* 축출 중인 페이지라면 끝나기를 기다립니다. 축출이 실패해 매핑이
+	 * 되돌려졌다면 다시 접근하기만 하면 됩니다. */
+	if (page->frame != NULL) {
+		bool mapped;
+
+		lock_acquire (&frame_lock);
+		vm_wait_frame (page);
+		mapped = page->frame != NULL;
+		lock_release (&frame_lock);
+		if (mapped)
+			return true;
+	}
+
+	if (!write && vm_is_zero_fill (page))
+		return vm_map_zero_frame (page);
+
+	if (vm_is_lazy_file (page)) {
+		if (!vm_do_claim_page (page))
+			return false;
+		vm_fault_around (page);
+		return true;
+	}
 
 	return vm_do_claim_page (page);
 }
 
+/* 성공 시 true를 반환합니다 */
+bool
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	long long sectors = thread_current ()->disk_sectors;
+	uint64_t start = rdtsc ();
+	int type;
+	bool success = vm_handle_fault (f, addr, user, write, not_present, &type);
+
+	vm_record_fault (type, rdtsc () - start,
+			thread_current ()->disk_sectors - sectors);
+	return success;
+}
+
+/* 끝나는 현재 프로세스의 폴트 통계를 FAULT_LOG에 남깁니다. */
+void
+vm_save_fault_stats (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	size_t i = fault_log_cnt++ % FAULT_LOG_CNT;
+
+	strlcpy (fault_log[i].name, curr->name, sizeof fault_log[i].name);
+	fault_log[i].tid = curr->tid;
+	fault_log[i].faults = curr->faults;
+	intr_set_level (old_level);
+}
+
+/* CNT개를 담은 log2 히스토그램 HIST에서 50, 90, 99 백분위수의 상한을
+ * BOUND에 구합니다. 칸 I의 상한은 2^(I+1)이지만, long long에 담기지
+ * 않는 마지막 두 칸은 LLONG_MAX로 둡니다. */
+static void
+vm_hist_bounds (const long long hist[64], long long cnt, long long bound[3]) {
+	static const int percentiles[] = { 50, 90, 99 };
+	long long seen = 0;
+	size_t i, p = 0;
+
+	for (i = 0; i < 64 && p < 3; i++) {
+		seen += hist[i];
+		while (p < 3 && seen * 100 >= cnt * percentiles[p])
+			bound[p++] = i + 1 < 63 ? 1LL << (i + 1) : LLONG_MAX;
+	}
+	while (p < 3)
+		bound[p++] = 0;
+}
+
+/* 가상 메모리 통계를 출력합니다. 폴트 처리 시간은 log2 히스토그램에서
+ * 구한 백분위수의 상한입니다. 폴트 종류별 통계와 최근에 끝난
+ * 프로세스들의 종류별 폴트 수와 섹터 수도 함께 출력합니다. */
+void
+vm_print_stats (void) {
+	long long hist[64] = { 0 };
+	long long bound[3];
+	long long handled = 0;
+	size_t i, t;
+
+	for (t = 0; t < FAULT_TYPE_CNT; t++) {
+		if (t == FAULT_INVALID)
+			continue;
+		handled += fault_stats[t].cnt;
+		for (i = 0; i < 64; i++)
+			hist[i] += fault_stats[t].hist[i];
+	}
+	vm_hist_bounds (hist, handled, bound);
+
+	printf ("Page faults: %lld handled, latency p50 < %lld, p90 < %lld, "
+			"p99 < %lld cycles, %lld direct evictions, "
+			"%lld RSS limit evictions\n",
+			handled, bound[0], bound[1], bound[2], direct_evict_cnt,
+			limit_evict_cnt);
+
+	for (t = 0; t < FAULT_TYPE_CNT; t++) {
+		if (fault_stats[t].cnt == 0)
+			continue;
+		vm_hist_bounds (fault_stats[t].hist, fault_stats[t].cnt, bound);
+		printf ("  %-7s %lld faults, %lld sectors, p50 < %lld, p90 < %lld, "
+				"p99 < %lld cycles\n", fault_names[t], fault_stats[t].cnt,
+				fault_stats[t].sectors, bound[0], bound[1], bound[2]);
+	}
+
+	i = fault_log_cnt > FAULT_LOG_CNT ? fault_log_cnt - FAULT_LOG_CNT : 0;
+	for (; i < fault_log_cnt; i++) {
+		const struct faultstat *fs = &fault_log[i % FAULT_LOG_CNT].faults;
+
+		printf ("  %s (tid %d):", fault_log[i % FAULT_LOG_CNT].name,
+				fault_log[i % FAULT_LOG_CNT].tid);
+		for (t = 0; t < FAULT_TYPE_CNT; t++)
+			if (fs->type[t].cnt > 0)
+				printf (" %s %lld/%lld", fault_names[t], fs->type[t].cnt,
+						fs->type[t].sectors);
+		printf ("\n");
+	}
+}
+
 /* 페이지를 해제합니다.
  * 이 함수를 수정하지 마세요. */
 void
@@ -146,9 +1091,10 @@ vm_dealloc_page (struct page *page) {
 
 /* VA에 할당된 페이지를 클레임합니다. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: 이 함수를 채우세요 */
+vm_claim_page (void *va) {
+	struct page *page = vm_get_page (va);
+	if (page == NULL)
+		return false;
 
 	return vm_do_claim_page (page);
 }
@@ -156,31 +1102,294 @@ vm_claim_page (void *va UNUSED) {
 /* PAGE를 클레임하고 mmu를 설정합니다. */
 static bool
 vm_do_claim_page (struct page *page) {
+	if (vm_is_shm (page))
+		return vm_claim_shm (page);
+	if (vm_is_shared_file (page))
+		return vm_claim_shared (page);
+	return vm_claim_frame (page);
+}
+
+/* PAGE가 공유 메모리 세그먼트의 페이지이면 true를 반환합니다. */
+static bool
+vm_is_shm (struct page *page) {
+	return page->vma != NULL && page->vma->shm != NULL;
+}
+
+/* 공유 메모리 페이지 PAGE를 클레임합니다.
+ * 세그먼트의 같은 페이지가 이미 프레임에 올라와 있으면 그 프레임을 쓰기
+ * 가능하게 함께 매핑하고, 없으면 새 프레임을 스왑 슬롯이나 0으로 채워
+ * 세그먼트에 등록합니다. 세그먼트 잠금을 쥐고 하므로 두 프로세스가 같은
+ * 페이지를 따로 채우는 일은 없습니다. */
+static bool
+vm_claim_shm (struct page *page) {
+	struct shm_segment *seg = page->vma->shm;
+	struct shm_page *sp = shm_lookup (page);
+	bool success = true;
+
+	lock_acquire (&seg->lock);
+	lock_acquire (&frame_lock);
+	while (sp->frame != NULL && sp->frame->evicting)
+		cond_wait (&evict_done, &frame_lock);
+	if (sp->frame != NULL) {
+		success = vm_frame_link (sp->frame, page, page->writable);
+		if (success && page->operations->type == VM_UNINIT) {
+			/* 내용은 이미 프레임에 있으므로 초기화 콜백 없이 타입만
+			 * 바꿉니다. */
+			struct uninit_page uninit = page->uninit;
+			success = uninit.page_initializer (page, uninit.type,
+					sp->frame->kva);
+		}
+		lock_release (&frame_lock);
+	} else {
+		lock_release (&frame_lock);
+		success = vm_claim_frame (page);
+	}
+	lock_release (&seg->lock);
+	return success;
+}
+
+/* PAGE가 쓰기 금지된 실행 파일의 내용을 가진 읽기 전용 페이지, 즉 같은
+ * 파일을 실행한 다른 프로세스와 프레임을 함께 쓸 수 있는 페이지이면
+ * true를 반환합니다. 이런 페이지는 내용이 파일과 항상 같으므로 축출된
+ * 뒤에도 파일에서 다시 읽습니다. 공유 캐시는 파일에 대한 쓰기를 보지
+ * 못하므로, 쓰기 금지되지 않은 파일의 읽기 전용 mmap()은 공유하지
+ * 않습니다. */
+static bool
+vm_is_shared_file (struct page *page) {
+	return !page->writable && page->vma != NULL && page->vma->shareable
+		&& vma_has_file_data (page->vma, page->va);
+}
+
+/* 읽기 전용 파일 페이지 PAGE를 공유 페이지 캐시의 프레임으로 클레임합니다.
+ * 캐시에 없으면 새 프레임에 읽어 들인 뒤 캐시에 등록합니다. 그 사이
+ * 다른 프로세스가 같은 페이지를 먼저 등록했다면 그 프레임으로 옮기고
+ * 방금 읽은 프레임은 버립니다. */
+static bool
+vm_claim_shared (struct page *page) {
+	struct vma *vma = page->vma;
+	struct inode *inode = file_get_inode (vma->file);
+	size_t page_ofs = (uint8_t *) page->va - (uint8_t *) vma->start;
+	off_t ofs = vma->ofs + page_ofs;
+	size_t read_bytes = vma->read_bytes - page_ofs;
+	struct frame *frame;
+	bool success = true;
+
+	if (read_bytes > PGSIZE)
+		read_bytes = PGSIZE;
+
+	lock_acquire (&frame_lock);
+	frame = share_lookup (inode, ofs, read_bytes);
+	if (frame != NULL) {
+		success = vm_frame_link (frame, page, false);
+		if (success && page->operations->type == VM_UNINIT) {
+			/* 내용은 이미 프레임에 있으므로 초기화 콜백 없이 타입만
+			 * 바꿉니다. */
+			struct uninit_page uninit = page->uninit;
+			success = uninit.page_initializer (page, uninit.type, frame->kva);
+		}
+		lock_release (&frame_lock);
+		return success;
+	}
+	lock_release (&frame_lock);
+
+	if (!vm_claim_frame (page))
+		return false;
+
+	lock_acquire (&frame_lock);
+	vm_wait_frame (page);
+	frame = share_lookup (inode, ofs, read_bytes);
+	if (page->frame == NULL) {
+		/* 그 사이 축출되었습니다. 다시 접근하면 새로 클레임됩니다. */
+	} else if (frame == NULL)
+		share_insert (page->frame, inode, ofs, read_bytes);
+	else if (frame != page->frame) {
+		vm_frame_unlink (page);
+		success = vm_frame_link (frame, page, false);
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* PAGE에 새 프레임을 얻어 내용을 채우고 매핑합니다.
+ * 프레임은 내용이 다 채워진 뒤에야 사용 중으로 표시되므로, 그 전에는
+ * 축출이나 KSM 같은 다른 스레드가 이 프레임을 건드리지 않습니다. */
+static bool
+vm_claim_frame (struct page *page) {
 	struct frame *frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
 
 	/* 링크 설정 */
-	frame->page = page;
-	page->frame = frame;
+	if (!vm_frame_link (frame, page, page->writable))
+		goto fail;
+
+	if (!swap_in (page, frame->kva))
+		goto fail;
+
+	lock_acquire (&frame_lock);
+	frame->in_use = true;
+	lock_release (&frame_lock);
+	return true;
+
+fail:
+	pml4_clear_page (page->owner->pml4, page->va);
+	list_remove (&page->frame_elem);
+	frame->ref_cnt--;
+	vm_add_rss (page->owner, -1);
+	page->frame = NULL;
+	vm_free_frame (frame);
+	return false;
+}
+
+/* PAGE의 페이지 테이블 항목을 제거하고 PAGE가 들고 있던 프레임을 반납합니다.
+ * 다른 페이지와 공유하는 프레임은 마지막 페이지가 놓을 때 해제되고,
+ * 제로 프레임은 모든 프로세스가 공유하므로 매핑만 끊습니다.
+ * 타입별 destroy에서 내용을 라이트백한 뒤에 호출합니다. */
+void
+vm_release_frame (struct page *page) {
+	if (page->frame == NULL)
+		return;
+
+	lock_acquire (&frame_lock);
+	vm_wait_frame (page);
+	if (page->frame != NULL)
+		vm_frame_unlink (page);
+	lock_release (&frame_lock);
+}
+
+/* PAGE가 프레임에 올라와 있으면 그 프레임이 축출되거나 KSM에 의해
+ * 바뀌지 않도록 고정하고 true를 반환합니다. 올라와 있지 않으면 false를
+ * 반환합니다. */
+bool
+vm_pin_frame (struct page *page) {
+	bool pinned;
+
+	lock_acquire (&frame_lock);
+	vm_wait_frame (page);
+	pinned = page->frame != NULL && page->frame != &zero_frame;
+	if (pinned)
+		page->frame->pin_cnt++;
+	lock_release (&frame_lock);
+	return pinned;
+}
+
+/* vm_pin_frame()으로 고정한 PAGE의 프레임을 풉니다. */
+void
+vm_unpin_frame (struct page *page) {
+	lock_acquire (&frame_lock);
+	ASSERT (page->frame->pin_cnt > 0);
+	page->frame->pin_cnt--;
+	lock_release (&frame_lock);
+}
 
-	/* TODO: 페이지의 VA를 프레임의 PA에 매핑하는 페이지 테이블 항목을 삽입하세요. */
+/* PAGE를 필요하면 클레임해서 프레임에 올리고 고정합니다. */
+static bool
+vm_pin_page (struct page *page) {
+	while (!vm_pin_frame (page))
+		if (!vm_do_claim_page (page))
+			return false;
+	return true;
+}
+
+static uint64_t
+page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *page = hash_entry (e, struct page, spt_elem);
+	return hash_bytes (&page->va, sizeof page->va);
+}
 
-	return swap_in (page, frame->kva);
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct page, spt_elem)->va
+		< hash_entry (b, struct page, spt_elem)->va;
+}
+
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED) {
+	vm_dealloc_page (hash_entry (e, struct page, spt_elem));
 }
 
 /* 새로운 보조 페이지 테이블을 초기화합니다 */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	vma_tree_init (&spt->vmas);
+	hash_init (&spt->pages, page_hash, page_less, NULL);
+	spt->fa_next = NULL;
+	spt->fa_window = 0;
+	list_init (&spt->shm_opens);
+}
+
+/* SRC의 VMA 하나를 현재 스레드의 spt인 DST로 복사합니다.
+ * 구간은 통째로 복사하고, 부모에서 이미 내용이 채워진 페이지만 새로
+ * 만들어 내용을 옮깁니다. 나머지 페이지는 자식에서 폴트가 날 때 VMA로부터
+ * 다시 만들어집니다. */
+static bool
+copy_vma (struct vma *src, void *dst_) {
+	struct supplemental_page_table *dst = dst_;
+	struct vma *vma = vma_duplicate (src);
+	struct list_elem *e;
+
+	if (vma == NULL)
+		return false;
+	if (!spt_insert_vma (dst, vma)) {
+		vma_destroy (vma);
+		return false;
+	}
+	/* 공유 메모리는 자식도 같은 세그먼트를 매핑하므로 폴트가 나면
+	 * 세그먼트에서 프레임을 찾습니다. */
+	if (vma->shm != NULL)
+		return true;
+
+	for (e = list_begin (&src->pages); e != list_end (&src->pages);
+			e = list_next (e)) {
+		struct page *parent = list_entry (e, struct page, vma_elem);
+		struct page *child;
+
+		if (parent->operations->type == VM_UNINIT)
+			continue;
+
+		child = vm_alloc_vma_page (vma, parent->va);
+		if (child == NULL)
+			return false;
+		/* 읽기 전용 파일 페이지는 부모와 같은 공유 프레임을 씁니다. */
+		if (vm_is_shared_file (child)) {
+			if (!vm_do_claim_page (child))
+				return false;
+			continue;
+		}
+		/* 내용은 부모의 프레임에서 복사하므로 파일에서 읽지 않습니다.
+		 * 복사하는 동안 두 프레임이 축출되거나 KSM에 의해 바뀌지 않도록
+		 * 고정합니다. */
+		child->uninit.init = NULL;
+		if (!vm_pin_page (parent))
+			return false;
+		if (!vm_pin_page (child)) {
+			vm_unpin_frame (parent);
+			return false;
+		}
+		memcpy (child->frame->kva, parent->frame->kva, PGSIZE);
+		vm_unpin_frame (child);
+		vm_unpin_frame (parent);
+	}
+	return true;
 }
 
 /* 보조 페이지 테이블을 src에서 dst로 복사합니다 */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	return vma_tree_for_each (&src->vmas, copy_vma, dst);
 }
 
 /* 보조 페이지 테이블이 보유한 리소스를 해제합니다 */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: 스레드가 보유한 모든 supplemental_page_table을 파괴하고
-	 * TODO: 수정된 모든 내용을 저장소에 라이트백하세요. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	/* 각 페이지의 destroy가 매핑을 끊고 프레임을 반납하므로, 이후의
+	 * pml4_destroy()가 사용자 프레임(특히 제로 프레임)을 해제하지 않습니다.
+	 * 연 세그먼트의 참조를 먼저 놓아, 이 프로세스만 매핑하던 공유 메모리
+	 * 페이지는 내보내지 않고 바로 버리게 합니다. */
+	shm_exit (spt);
+	while (spt->vmas.root != NULL)
+		spt_remove_vma (spt, spt->vmas.root);
+	hash_destroy (&spt->pages, page_destructor);
 }
@@ -0,0 +1,310 @@
+/* vma.c: 가상 메모리 영역(VMA)과 그 구간 트리의 구현.
+ *
+ * 보조 페이지 테이블은 매핑을 VMA 단위로 기록합니다. mmap이나 세그먼트
+ * 로딩은 VMA 하나를 트리에 넣는 것으로 끝나므로 매핑 크기와 상관없이
+ * 상수 시간이 걸리고, struct page는 폴트가 난 페이지에 대해서만
+ * 만들어집니다. */
+
+#include <round.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+#include "vm/vma.h"
+
+/* 파일 FILE의 OFS부터 READ_BYTES 바이트를 읽고 나머지를 0으로 채우는,
+ * START에서 시작하는 LENGTH 바이트 크기의 TYPE 타입 VMA를 만듭니다.
+ * FILE은 다시 열어서 보관하므로 호출자는 FILE을 마음대로 닫아도
+ * 됩니다. START와 OFS는 페이지 단위로 정렬되어 있어야 하며, LENGTH는
+ * 페이지 크기로 올림합니다. 메모리가 부족하면 NULL을 반환합니다. */
+struct vma *
+vma_create (enum vm_type type, void *start, size_t length, bool writable,
+		struct file *file, off_t ofs, size_t read_bytes) {
+	struct vma *vma;
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (ofs % PGSIZE == 0);
+	ASSERT (length > 0);
+	ASSERT (read_bytes <= length);
+	ASSERT (file != NULL || read_bytes == 0);
+
+	vma = malloc (sizeof *vma);
+	if (vma == NULL)
+		return NULL;
+
+	vma->file = NULL;
+	if (file != NULL) {
+		vma->file = file_reopen (file);
+		if (vma->file == NULL) {
+			free (vma);
+			return NULL;
+		}
+	}
+
+	vma->start = start;
+	vma->end = (uint8_t *) start + ROUND_UP (length, PGSIZE);
+	vma->type = type;
+	vma->writable = writable;
+	vma->ofs = ofs;
+	vma->read_bytes = read_bytes;
+	list_init (&vma->pages);
+	vma->advice = MADV_NORMAL;
+	vma->shm = NULL;
+	vma->shareable = false;
+	vma->left = vma->right = NULL;
+	vma->max_end = vma->end;
+	vma->height = 1;
+	return vma;
+}
+
+/* VMA와 같은 구간, 같은 백업 객체를 가진 새 VMA를 만듭니다.
+ * 이미 만들어진 페이지는 복사하지 않습니다. */
+struct vma *
+vma_duplicate (const struct vma *vma) {
+	struct vma *copy = vma_create (vma->type, vma->start,
+			(uint8_t *) vma->end - (uint8_t *) vma->start, vma->writable,
+			vma->file, vma->ofs, vma->read_bytes);
+
+	if (copy != NULL) {
+		copy->advice = vma->advice;
+		copy->shareable = vma->shareable;
+		if (vma->shm != NULL) {
+			copy->shm = vma->shm;
+			shm_segment_get (copy->shm);
+		}
+	}
+	return copy;
+}
+
+/* VMA를 해제합니다. VMA는 트리에서 빠져 있어야 하고, 그 안의 페이지는
+ * 모두 먼저 제거되어 있어야 합니다. */
+void
+vma_destroy (struct vma *vma) {
+	ASSERT (list_empty (&vma->pages));
+
+	file_close (vma->file);
+	if (vma->shm != NULL)
+		shm_segment_put (vma->shm);
+	free (vma);
+}
+
+/* VMA 안의 페이지 VA가 파일에서 읽어 올 내용을 가지면 true를 반환합니다.
+ * 그렇지 않은 페이지는 0으로 채워집니다. */
+bool
+vma_has_file_data (const struct vma *vma, const void *va) {
+	return (size_t) ((uint8_t *) va - (uint8_t *) vma->start)
+		< vma->read_bytes;
+}
+
+/* 파일 내용을 가진 페이지의 초기화 콜백.
+ * PAGE가 속한 VMA로부터 파일 오프셋과 읽을 바이트 수를 계산해 프레임을
+ * 채웁니다. */
+bool
+vma_load_page (struct page *page, void *aux UNUSED) {
+	struct vma *vma = page->vma;
+	size_t page_ofs = (uint8_t *) page->va - (uint8_t *) vma->start;
+	size_t read_bytes = vma->read_bytes - page_ofs;
+	uint8_t *kva = page->frame->kva;
+
+	ASSERT (page_ofs < vma->read_bytes);
+	if (read_bytes > PGSIZE)
+		read_bytes = PGSIZE;
+	if (file_read_at (vma->file, kva, read_bytes, vma->ofs + page_ofs)
+			!= (off_t) read_bytes)
+		return false;
+	memset (kva + read_bytes, 0, PGSIZE - read_bytes);
+	return true;
+}
+
+/* 구간 트리 */
+
+static int
+height (const struct vma *n) {
+	return n != NULL ? n->height : 0;
+}
+
+/* N의 높이와 MAX_END를 자식으로부터 다시 계산합니다. */
+static void
+update (struct vma *n) {
+	int lh = height (n->left), rh = height (n->right);
+
+	n->height = (lh > rh ? lh : rh) + 1;
+	n->max_end = n->end;
+	if (n->left != NULL && n->left->max_end > n->max_end)
+		n->max_end = n->left->max_end;
+	if (n->right != NULL && n->right->max_end > n->max_end)
+		n->max_end = n->right->max_end;
+}
+
+static struct vma *
+rotate_right (struct vma *n) {
+	struct vma *l = n->left;
+
+	n->left = l->right;
+	l->right = n;
+	update (n);
+	update (l);
+	return l;
+}
+
+static struct vma *
+rotate_left (struct vma *n) {
+	struct vma *r = n->right;
+
+	n->right = r->left;
+	r->left = n;
+	update (n);
+	update (r);
+	return r;
+}
+
+/* N을 루트로 하는 서브트리의 균형을 맞추고 새 루트를 반환합니다. */
+static struct vma *
+rebalance (struct vma *n) {
+	int balance;
+
+	update (n);
+	balance = height (n->left) - height (n->right);
+	if (balance > 1) {
+		if (height (n->left->left) < height (n->left->right))
+			n->left = rotate_left (n->left);
+		return rotate_right (n);
+	}
+	if (balance < -1) {
+		if (height (n->right->right) < height (n->right->left))
+			n->right = rotate_right (n->right);
+		return rotate_left (n);
+	}
+	return n;
+}
+
+static struct vma *
+tree_insert (struct vma *n, struct vma *vma) {
+	if (n == NULL)
+		return vma;
+	if (vma->start < n->start)
+		n->left = tree_insert (n->left, vma);
+	else
+		n->right = tree_insert (n->right, vma);
+	return rebalance (n);
+}
+
+/* N에서 가장 왼쪽 노드를 떼어 *MIN에 저장하고 새 루트를 반환합니다. */
+static struct vma *
+remove_min (struct vma *n, struct vma **min) {
+	if (n->left == NULL) {
+		*min = n;
+		return n->right;
+	}
+	n->left = remove_min (n->left, min);
+	return rebalance (n);
+}
+
+static struct vma *
+tree_remove (struct vma *n, struct vma *vma) {
+	ASSERT (n != NULL);
+
+	if (vma->start < n->start)
+		n->left = tree_remove (n->left, vma);
+	else if (vma->start > n->start)
+		n->right = tree_remove (n->right, vma);
+	else {
+		struct vma *min;
+
+		ASSERT (n == vma);
+		if (n->right == NULL)
+			return n->left;
+		n->right = remove_min (n->right, &min);
+		min->left = n->left;
+		min->right = n->right;
+		return rebalance (min);
+	}
+	return rebalance (n);
+}
+
+static bool
+for_each (struct vma *n, vma_action_func *action, void *aux) {
+	return n == NULL
+		|| (for_each (n->left, action, aux)
+				&& action (n, aux)
+				&& for_each (n->right, action, aux));
+}
+
+/* 빈 구간 트리로 초기화합니다. */
+void
+vma_tree_init (struct vma_tree *tree) {
+	tree->root = NULL;
+}
+
+/* VMA를 TREE에 넣습니다. 이미 있는 VMA와 구간이 겹치면 넣지 않고
+ * false를 반환합니다. */
+bool
+vma_tree_insert (struct vma_tree *tree, struct vma *vma) {
+	if (vma_tree_overlap (tree, vma->start, vma->end) != NULL)
+		return false;
+
+	vma->left = vma->right = NULL;
+	update (vma);
+	tree->root = tree_insert (tree->root, vma);
+	return true;
+}
+
+/* TREE에서 VMA를 뺍니다. VMA 자체는 해제하지 않습니다. */
+void
+vma_tree_remove (struct vma_tree *tree, struct vma *vma) {
+	tree->root = tree_remove (tree->root, vma);
+	vma->left = vma->right = NULL;
+}
+
+/* 주소 VA를 포함하는 VMA를 반환합니다. 없으면 NULL을 반환합니다. */
+struct vma *
+vma_tree_find (struct vma_tree *tree, const void *va) {
+	return vma_tree_overlap (tree, va, (const uint8_t *) va + 1);
+}
+
+/* 구간 [START, END)와 겹치는 VMA 하나를 반환합니다. 없으면 NULL을
+ * 반환합니다. 왼쪽 서브트리의 최대 END가 START보다 크면 겹치는 VMA가
+ * 있다면 반드시 왼쪽에도 있으므로, 한 경로만 따라 내려가면 됩니다. */
+struct vma *
+vma_tree_overlap (struct vma_tree *tree, const void *start,
+		const void *end) {
+	struct vma *n = tree->root;
+
+	while (n != NULL) {
+		if ((const void *) n->start < end && start < (const void *) n->end)
+			return n;
+		if (n->left != NULL && (const void *) n->left->max_end > start)
+			n = n->left;
+		else
+			n = n->right;
+	}
+	return NULL;
+}
+
+/* TREE 안의 VMA가 START부터 시작하도록 아래쪽으로 넓힙니다. 스택처럼
+ * 아래로 자라는 익명 영역에 씁니다. 새로 덮는 구간이 다른 VMA와 겹치면
+ * false를 반환합니다. 이웃 VMA를 넘지 않으므로 트리의 순서는 그대로
+ * 유지됩니다. */
+bool
+vma_tree_grow_down (struct vma_tree *tree, struct vma *vma, void *start) {
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (vma->file == NULL);
+
+	if (start >= vma->start)
+		return true;
+	if (vma_tree_overlap (tree, start, vma->start) != NULL)
+		return false;
+	vma->start = start;
+	return true;
+}
+
+/* TREE의 모든 VMA에 대해 주소 순서대로 ACTION을 호출합니다. ACTION이
+ * false를 반환하면 멈추고 false를 반환합니다. ACTION 안에서 TREE를
+ * 바꾸면 안 됩니다. */
+bool
+vma_tree_for_each (struct vma_tree *tree, vma_action_func *action,
+		void *aux) {
+	return for_each (tree->root, action, aux);
+}